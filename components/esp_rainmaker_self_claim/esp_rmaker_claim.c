@@ -50,6 +50,8 @@ static const char *TAG = "esp_claim";
 #define CLAIM_BASE_URL      "https://esp-claiming.rainmaker.espressif.com"
 #define CLAIM_INIT_PATH     "claim/initiate"
 #define CLAIM_VERIFY_PATH   "claim/verify"
+/* The claim responses are flat objects of a few strings */
+#define CLAIM_RESPONSE_MAX_TOKENS   16
 
 extern uint8_t claim_service_server_root_ca_pem_start[] asm("_binary_rmaker_claim_service_server_crt_start");
 extern uint8_t claim_service_server_root_ca_pem_end[] asm("_binary_rmaker_claim_service_server_crt_end");
@@ -63,45 +65,6 @@ static char *self_claim_certificate = NULL;
 static char *self_claim_private_key = NULL;
 static const char *self_claim_name = NULL;
 
-static void escape_new_line(esp_rmaker_claim_data_t *data)
-{
-    char *str = (char *)data->csr;
-    memset(data->payload, 0, sizeof(data->payload));
-    char *target_str = (char *)data->payload;
-    /* Hack to just avoid a "\r\n" at the end of string */
-    if (str[strlen(str) - 1] == '\n') {
-        str[strlen(str) - 1] = '\0';
-    }
-    while (*str) {
-        if (*str == '\n') {
-            *target_str++ = '\\';
-            *target_str++ = 'n';
-            str++;
-            continue;
-        }
-        *target_str++ = *str++;
-    }
-    *target_str = '\0';
-    strcpy((char *)data->csr, (char *)data->payload);
-    ESP_LOGD(TAG, "Modified CSR : %s", data->csr);
-}
-
-static void unescape_new_line(char *str)
-{
-    char *target_str = str;
-    while (*str) {
-        if (*str == '\\') {
-            str++;
-            if (*str == 'n') {
-                *target_str++ = '\n';
-                str++;
-            }
-        }
-        *target_str++ = *str++;
-    }
-    *target_str = '\0';
-}
-
 static esp_err_t esp_rmaker_claim_generate_csr(esp_rmaker_claim_data_t *claim_data, const char *common_name)
 {
     if (!claim_data || !common_name) {
@@ -209,19 +172,21 @@ static esp_err_t handle_claim_verify_response(esp_rmaker_claim_data_t *claim_dat
 {
     ESP_LOGD(TAG, "Claim Verify Response: %s", claim_data->payload);
     jparse_ctx_t jctx;
-    if (json_parse_start(&jctx, claim_data->payload, strlen(claim_data->payload)) == 0) {
-        int required_len = 0;
-        if (json_obj_get_strlen(&jctx, "certificate", &required_len) == 0) {
-            required_len++; /* For NULL termination */
-            self_claim_certificate =  calloc(1, required_len + 1);
+    json_tok_t tokens[CLAIM_RESPONSE_MAX_TOKENS];
+    if (json_parse_start_static(&jctx, claim_data->payload, strlen(claim_data->payload),
+                tokens, CLAIM_RESPONSE_MAX_TOKENS) == 0) {
+        char *certificate;
+        int cert_len = 0;
+        /* Decoded in the payload buffer itself, so only the final copy is needed */
+        if (json_obj_get_string_inplace(&jctx, "certificate", &certificate, &cert_len) == 0) {
+            self_claim_certificate = malloc(cert_len + 1);
             if (!self_claim_certificate) {
                 json_parse_end(&jctx);
-                ESP_LOGE(TAG, "Failed to allocate %d bytes for certificate.", required_len);
+                ESP_LOGE(TAG, "Failed to allocate %d bytes for certificate.", cert_len + 1);
                 return ESP_ERR_NO_MEM;
             }
-            json_obj_get_string(&jctx, "certificate", self_claim_certificate, required_len);
+            memcpy(self_claim_certificate, certificate, cert_len + 1);
             json_parse_end(&jctx);
-            unescape_new_line(self_claim_certificate);
             return ESP_OK;
         } else {
             ESP_LOGE(TAG, "Claim Verify Response invalid.");
@@ -309,7 +274,9 @@ static esp_err_t handle_self_claim_init_response(esp_rmaker_claim_data_t *claim_
 {
     ESP_LOGD(TAG, "Claim Init Response: %s", claim_data->payload);
     jparse_ctx_t jctx;
-    if (json_parse_start(&jctx, claim_data->payload, strlen(claim_data->payload)) == 0) {
+    json_tok_t tokens[CLAIM_RESPONSE_MAX_TOKENS];
+    if (json_parse_start_static(&jctx, claim_data->payload, strlen(claim_data->payload),
+                tokens, CLAIM_RESPONSE_MAX_TOKENS) == 0) {
         char auth_id[64];
         char challenge[130];
         int ret = json_obj_get_string(&jctx, "auth_id", auth_id, sizeof(auth_id));
@@ -471,10 +438,13 @@ esp_err_t __esp_rmaker_claim_init(esp_rmaker_claim_data_t *claim_data)
         ESP_LOGE(TAG, "Failed to generate CSR.");
         return err;
     }
-     /* New line characters from the CSR need to be removed and replaced with explicit \n for the claiming
-     * service to parse properly. Make that change here and store the CSR in storage.
+    /* The claiming service does not expect a new line at the end of the CSR. The other new lines
+     * get escaped by json_generator when the CSR is added to the claim init request.
      */
-    escape_new_line(claim_data);
+    size_t csr_len = strlen((char *)claim_data->csr);
+    if (csr_len && claim_data->csr[csr_len - 1] == '\n') {
+        claim_data->csr[csr_len - 1] = '\0';
+    }
     return err;
 }
 
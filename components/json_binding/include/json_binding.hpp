@@ -0,0 +1,308 @@
+// Copyright 2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#if __cplusplus < 201703L
+#error "json_binding needs C++17"
+#endif
+
+/*
+ * Declare the JSON fields of a struct once and get both a decoder (over a parsed
+ * json_parser document) and an encoder (to json_generator) for it:
+ *
+ *     struct channel {
+ *         int id;
+ *         float rate;
+ *         bool enabled;
+ *         char name[32];
+ *     };
+ *
+ *     template <> struct json_binding::schema<channel> {
+ *         static constexpr auto fields = std::make_tuple(
+ *             json_binding::field("id", &channel::id),
+ *             json_binding::field("rate", &channel::rate),
+ *             json_binding::field("enabled", &channel::enabled),
+ *             json_binding::field("name", &channel::name));
+ *     };
+ *
+ *     channel ch;
+ *     json_binding::decode(&jctx, ch);    // From the current object of jctx
+ *     json_binding::encode(&jstr, ch);    // As a complete object
+ *
+ * Supported members are bool, integers of up to 64 bits (except unsigned 64 bit ones),
+ * float, char arrays (strings), other structs with a schema (nested objects) and
+ * json_binding::array<>. double is rejected at compile time, as neither json_parser
+ * nor json_generator has a double API. Values out of range of a member fail decoding.
+ * Strings are decoded with their escapes resolved and fail if that does not fit.
+ *
+ * Key hashes are computed at compile time. Decoding walks the members of the object
+ * once and matches each key by its hash and length (taken from the token), so there
+ * are no strlen() calls and nothing is allocated. Members missing from the document
+ * are left untouched. Encoding passes the same compile time lengths to the *_n()
+ * APIs of json_generator.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <json_parser.h>
+#include <json_generator.h>
+
+namespace json_binding {
+
+/* FNV-1a */
+constexpr uint32_t key_hash(const char *key, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+template <typename T, typename M>
+struct field_t {
+    const char *name;
+    size_t len;
+    uint32_t hash;
+    M T::*member;
+};
+
+template <typename T, typename M, size_t N>
+constexpr field_t<T, M> field(const char (&name)[N], M T::*member)
+{
+    return field_t<T, M> {name, N - 1, key_hash(name, N - 1), member};
+}
+
+/* Specialize with a "static constexpr auto fields" tuple of field()s */
+template <typename T>
+struct schema;
+
+/* A JSON array of up to N elements */
+template <typename T, size_t N>
+struct array {
+    T items[N];
+    int count;
+};
+
+namespace detail {
+
+template <typename T, typename = void>
+struct has_schema : std::false_type {};
+
+template <typename T>
+struct has_schema<T, std::void_t<decltype(schema<T>::fields)>> : std::true_type {};
+
+template <typename T>
+struct is_array : std::false_type {};
+
+template <typename T, size_t N>
+struct is_array<array<T, N>> : std::true_type {};
+
+template <typename T>
+constexpr bool is_int_v = std::is_integral_v<T> && !std::is_same_v<T, bool>
+        && (sizeof(T) < sizeof(int) || (sizeof(T) == sizeof(int) && std::is_signed_v<T>));
+
+/* Wider than int, so going through the int64_t APIs */
+template <typename T>
+constexpr bool is_int64_v = std::is_integral_v<T> && !std::is_same_v<T, bool> && !is_int_v<T>
+        && (sizeof(T) < sizeof(int64_t) || std::is_signed_v<T>);
+
+template <typename T>
+constexpr bool is_string_v = std::is_array_v<T> && std::is_same_v<std::remove_extent_t<T>, char>;
+
+template <typename T>
+int decode_object(json_iter_t *obj, T &out);
+
+/* Decodes the value at the iterator's current position */
+template <typename M>
+int decode_value(json_iter_t *it, M &val)
+{
+    if constexpr (std::is_same_v<M, bool>) {
+        return json_iter_get_bool(it, &val);
+    } else if constexpr (is_int_v<M>) {
+        int v;
+        if (json_iter_get_int(it, &v) != OS_SUCCESS) {
+            return -OS_FAIL;
+        }
+        if (v < std::numeric_limits<M>::min() || v > std::numeric_limits<M>::max()) {
+            return -OS_FAIL;
+        }
+        val = (M)v;
+        return OS_SUCCESS;
+    } else if constexpr (is_int64_v<M>) {
+        int64_t v;
+        if (json_iter_get_int64(it, &v) != OS_SUCCESS) {
+            return -OS_FAIL;
+        }
+        if (v < (int64_t)std::numeric_limits<M>::min() || v > (int64_t)std::numeric_limits<M>::max()) {
+            return -OS_FAIL;
+        }
+        val = (M)v;
+        return OS_SUCCESS;
+    } else if constexpr (std::is_same_v<M, float>) {
+        float v;
+        if (json_iter_get_float(it, &v) != OS_SUCCESS) {
+            return -OS_FAIL;
+        }
+        val = v;
+        return OS_SUCCESS;
+    } else if constexpr (is_string_v<M>) {
+        return json_iter_get_string_decoded(it, val, sizeof(M));
+    } else if constexpr (has_schema<M>::value) {
+        json_iter_t child;
+        if (json_iter_get_type(it) != JSMN_OBJECT || json_iter_begin_child(it, &child) != OS_SUCCESS) {
+            return -OS_FAIL;
+        }
+        return decode_object(&child, val);
+    } else if constexpr (is_array<M>::value) {
+        json_iter_t child;
+        if (json_iter_get_type(it) != JSMN_ARRAY || json_iter_begin_child(it, &child) != OS_SUCCESS) {
+            return -OS_FAIL;
+        }
+        val.count = 0;
+        for (; !json_iter_end(&child); json_iter_next(&child)) {
+            if (val.count == (int)(sizeof(val.items) / sizeof(val.items[0]))
+                    || decode_value(&child, val.items[val.count]) != OS_SUCCESS) {
+                return -OS_FAIL;
+            }
+            val.count++;
+        }
+        return OS_SUCCESS;
+    } else {
+        static_assert(!std::is_same_v<M, double>, "json_binding: double is not supported, use float");
+        static_assert(std::is_same_v<M, double> || !sizeof(M), "json_binding: unsupported member type");
+    }
+}
+
+template <typename T, typename M>
+bool decode_field(json_iter_t *it, const char *key, int len, uint32_t hash,
+                  const field_t<T, M> &f, T &out, int *ret)
+{
+    if (f.hash != hash || (int)f.len != len || memcmp(f.name, key, len) != 0) {
+        return false;
+    }
+    *ret = decode_value(it, out.*(f.member));
+    return true;
+}
+
+template <typename T>
+int decode_object(json_iter_t *obj, T &out)
+{
+    for (; !json_iter_end(obj); json_iter_next(obj)) {
+        char *key;
+        int len;
+        if (json_iter_get_key(obj, &key, &len) != OS_SUCCESS) {
+            return -OS_FAIL;
+        }
+        uint32_t hash = key_hash(key, len);
+        int ret = OS_SUCCESS;
+        /* Stops at the first field that matches. Unknown keys are ignored */
+        std::apply([&](const auto &... f) {
+            (decode_field(obj, key, len, hash, f, out, &ret) || ...);
+        }, schema<T>::fields);
+        if (ret != OS_SUCCESS) {
+            return -OS_FAIL;
+        }
+    }
+    return OS_SUCCESS;
+}
+
+template <typename T>
+int encode_members(json_gen_str_t *jstr, const T &in);
+
+/* Encodes an object member (name != NULL) or an array element (name == NULL) */
+template <typename M>
+int encode_value(json_gen_str_t *jstr, const char *name, int len, const M &val)
+{
+    if constexpr (std::is_same_v<M, bool>) {
+        return name ? json_gen_obj_set_bool_n(jstr, name, len, val) : json_gen_arr_set_bool(jstr, val);
+    } else if constexpr (is_int_v<M>) {
+        return name ? json_gen_obj_set_int_n(jstr, name, len, val) : json_gen_arr_set_int(jstr, val);
+    } else if constexpr (is_int64_v<M>) {
+        return name ? json_gen_obj_set_int64_n(jstr, name, len, val) : json_gen_arr_set_int64(jstr, val);
+    } else if constexpr (std::is_same_v<M, float>) {
+        return name ? json_gen_obj_set_float_n(jstr, name, len, val) : json_gen_arr_set_float(jstr, val);
+    } else if constexpr (is_string_v<M>) {
+        int val_len = strnlen(val, sizeof(M));
+        return name ? json_gen_obj_set_string_n(jstr, name, len, val, val_len)
+               : json_gen_arr_set_string_n(jstr, val, val_len);
+    } else if constexpr (has_schema<M>::value) {
+        int ret = name ? json_gen_push_object_n(jstr, name, len) : json_gen_start_object(jstr);
+        if (ret != OS_SUCCESS || encode_members(jstr, val) != OS_SUCCESS) {
+            return -OS_FAIL;
+        }
+        return name ? json_gen_pop_object(jstr) : json_gen_end_object(jstr);
+    } else if constexpr (is_array<M>::value) {
+        int ret = name ? json_gen_push_array_n(jstr, name, len) : json_gen_start_array(jstr);
+        for (int i = 0; i < val.count && ret == OS_SUCCESS; i++) {
+            ret = encode_value(jstr, nullptr, 0, val.items[i]);
+        }
+        if (ret != OS_SUCCESS) {
+            return -OS_FAIL;
+        }
+        return name ? json_gen_pop_array(jstr) : json_gen_end_array(jstr);
+    } else {
+        static_assert(!std::is_same_v<M, double>, "json_binding: double is not supported, use float");
+        static_assert(std::is_same_v<M, double> || !sizeof(M), "json_binding: unsupported member type");
+    }
+}
+
+template <typename T>
+int encode_members(json_gen_str_t *jstr, const T &in)
+{
+    int ret = OS_SUCCESS;
+    std::apply([&](const auto &... f) {
+        ((ret = (ret == OS_SUCCESS) ? encode_value(jstr, f.name, (int)f.len, in.*(f.member)) : ret), ...);
+    }, schema<T>::fields);
+    return ret;
+}
+
+} // namespace detail
+
+/* Decodes the current object of jctx (see json_obj_get_object()) into out */
+template <typename T>
+int decode(jparse_ctx_t *jctx, T &out)
+{
+    static_assert(detail::has_schema<T>::value, "json_binding: no schema for this type");
+    json_iter_t it;
+    if (jctx->cur->type != JSMN_OBJECT || json_iter_begin(jctx, &it) != OS_SUCCESS) {
+        return -OS_FAIL;
+    }
+    return detail::decode_object(&it, out);
+}
+
+/* Adds the fields of in to the object currently open in jstr */
+template <typename T>
+int encode_members(json_gen_str_t *jstr, const T &in)
+{
+    static_assert(detail::has_schema<T>::value, "json_binding: no schema for this type");
+    return detail::encode_members(jstr, in);
+}
+
+/* Writes in as a complete object, e.g. right after json_gen_str_start() */
+template <typename T>
+int encode(json_gen_str_t *jstr, const T &in)
+{
+    if (json_gen_start_object(jstr) != OS_SUCCESS || encode_members(jstr, in) != OS_SUCCESS) {
+        return -OS_FAIL;
+    }
+    return json_gen_end_object(jstr);
+}
+
+} // namespace json_binding
@@ -1,3 +1,3 @@
-COMPONENT_OBJS := upstream/json_generator.o
-COMPONENT_SRCDIRS := upstream
-COMPONENT_ADD_INCLUDEDIRS := upstream
+COMPONENT_OBJS := upstream/json_generator.o upstream/cbor_generator.o json_gen_sender.o
+COMPONENT_SRCDIRS := upstream .
+COMPONENT_ADD_INCLUDEDIRS := upstream .
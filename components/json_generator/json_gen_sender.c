@@ -0,0 +1,121 @@
+// Copyright 2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "json_gen_sender.h"
+
+static const char *TAG = "json_gen_sender";
+
+typedef struct {
+    char *buf;
+    int len;
+} json_gen_sender_chunk_t;
+
+struct json_gen_sender {
+    json_gen_sender_write_t write;
+    void *ctx;
+    /* Holds the one half handed over. A NULL buf stops the task */
+    QueueHandle_t queue;
+    /* Given back once that half has been written out */
+    SemaphoreHandle_t done;
+    bool failed;
+};
+
+static void json_gen_sender_task(void *arg)
+{
+    json_gen_sender_t *sender = (json_gen_sender_t *)arg;
+    json_gen_sender_chunk_t chunk;
+    while (xQueueReceive(sender->queue, &chunk, portMAX_DELAY) == pdTRUE && chunk.buf) {
+        if (!sender->failed && sender->write(chunk.buf, chunk.len, sender->ctx) != 0) {
+            ESP_LOGE(TAG, "Failed to write %d bytes", chunk.len);
+            sender->failed = true;
+        }
+        xSemaphoreGive(sender->done);
+    }
+    xSemaphoreGive(sender->done);
+    vTaskDelete(NULL);
+}
+
+static void json_gen_sender_flush(char *buf, int len, void *priv)
+{
+    json_gen_sender_t *sender = (json_gen_sender_t *)priv;
+    json_gen_sender_chunk_t chunk = {
+        .buf = buf,
+        .len = len,
+    };
+    xQueueSend(sender->queue, &chunk, portMAX_DELAY);
+}
+
+static void json_gen_sender_wait(void *priv)
+{
+    json_gen_sender_t *sender = (json_gen_sender_t *)priv;
+    xSemaphoreTake(sender->done, portMAX_DELAY);
+}
+
+json_gen_sender_t *json_gen_sender_create(json_gen_sender_write_t write, void *ctx,
+        uint32_t stack_size, UBaseType_t priority)
+{
+    json_gen_sender_t *sender = calloc(1, sizeof(json_gen_sender_t));
+    if (!sender) {
+        ESP_LOGE(TAG, "Failed to allocate sender");
+        return NULL;
+    }
+    sender->write = write;
+    sender->ctx = ctx;
+    sender->queue = xQueueCreate(1, sizeof(json_gen_sender_chunk_t));
+    sender->done = xSemaphoreCreateBinary();
+    if (!sender->queue || !sender->done ||
+            xTaskCreate(json_gen_sender_task, "json_gen_sender", stack_size, sender, priority, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sender task");
+        if (sender->queue) {
+            vQueueDelete(sender->queue);
+        }
+        if (sender->done) {
+            vSemaphoreDelete(sender->done);
+        }
+        free(sender);
+        return NULL;
+    }
+    return sender;
+}
+
+void json_gen_sender_delete(json_gen_sender_t *sender)
+{
+    if (!sender) {
+        return;
+    }
+    json_gen_sender_chunk_t stop = { 0 };
+    xQueueSend(sender->queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(sender->done, portMAX_DELAY);
+    vQueueDelete(sender->queue);
+    vSemaphoreDelete(sender->done);
+    free(sender);
+}
+
+void json_gen_sender_start(json_gen_sender_t *sender, json_gen_str_t *jstr, char *buf, int buf_size)
+{
+    sender->failed = false;
+    json_gen_str_start_async(jstr, buf, buf_size, json_gen_sender_flush, json_gen_sender_wait, sender);
+}
+
+esp_err_t json_gen_sender_get_status(json_gen_sender_t *sender)
+{
+    return sender->failed ? ESP_FAIL : ESP_OK;
+}
@@ -0,0 +1,57 @@
+// Copyright 2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/*
+ * A FreeRTOS sender task for json_gen_str_start_async(). The generator fills one
+ * half of the buffer while the task writes out the other one, e.g. with
+ * esp_tls_conn_write() or esp_http_client_write():
+ *
+ *     json_gen_sender_t *sender = json_gen_sender_create(write_chunk, tls, 4096, 5);
+ *     json_gen_sender_start(sender, &jstr, buf, sizeof(buf));
+ *     ... json_gen_*() calls ...
+ *     json_gen_str_end(&jstr);
+ *     if (json_gen_sender_get_status(sender) != ESP_OK) { ... }
+ */
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <json_generator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Writes out a chunk of the JSON string, returning 0 on success */
+typedef int (*json_gen_sender_write_t)(const char *buf, int len, void *ctx);
+
+typedef struct json_gen_sender json_gen_sender_t;
+
+json_gen_sender_t *json_gen_sender_create(json_gen_sender_write_t write, void *ctx,
+        uint32_t stack_size, UBaseType_t priority);
+
+/* Stops the task. Must not be called while a JSON string is being generated */
+void json_gen_sender_delete(json_gen_sender_t *sender);
+
+/* json_gen_str_start_async() with the callbacks of the sender. buf is used as two halves */
+void json_gen_sender_start(json_gen_sender_t *sender, json_gen_str_t *jstr, char *buf, int buf_size);
+
+/* ESP_FAIL if a write failed since json_gen_sender_start(). The chunks after it are dropped */
+esp_err_t json_gen_sender_get_status(json_gen_sender_t *sender);
+
+#ifdef __cplusplus
+}
+#endif
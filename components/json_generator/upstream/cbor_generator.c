@@ -0,0 +1,449 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <string.h>
+
+#include <cbor_generator.h>
+
+/* Major types */
+#define CBOR_UINT	0
+#define CBOR_NEGINT	1
+#define CBOR_TEXT	3
+#define CBOR_ARRAY	4
+#define CBOR_MAP	5
+
+#define CBOR_INDEFINITE_TEXT	0x7f
+#define CBOR_INDEFINITE_ARRAY	0x9f
+#define CBOR_INDEFINITE_MAP	0xbf
+#define CBOR_FALSE		0xf4
+#define CBOR_TRUE		0xf5
+#define CBOR_NULL		0xf6
+#define CBOR_HALF		0xf9
+#define CBOR_SINGLE		0xfa
+#define CBOR_BREAK		0xff
+
+/* Adds data to the buffer, flushing it out whenever it is full */
+static inline int cbor_gen_add(cbor_gen_str_t *cstr, const void *data, int len)
+{
+	cstr->total_len += len;
+	if (cstr->buf == NULL) {
+		return 0;
+	}
+	if (cstr->buf_size - (cstr->free_ptr - cstr->buf) >= len) {
+		memcpy(cstr->free_ptr, data, len);
+		cstr->free_ptr += len;
+		return 0;
+	}
+	const uint8_t *cur_ptr = data;
+	while (1) {
+		int len_remaining = cstr->buf_size - (cstr->free_ptr - cstr->buf);
+		int copy_len = len_remaining > len ? len : len_remaining;
+		memcpy(cstr->free_ptr, cur_ptr, copy_len);
+		cur_ptr += copy_len;
+		cstr->free_ptr += copy_len;
+		len -= copy_len;
+		if (!len)
+			break;
+		if (!cstr->flush_cb || cstr->free_ptr == cstr->buf) {
+			return -1;
+		}
+		cstr->flush_cb(cstr->buf, cstr->free_ptr - cstr->buf, cstr->priv);
+		cstr->free_ptr = cstr->buf;
+	}
+	return 0;
+}
+
+static int cbor_gen_add_byte(cbor_gen_str_t *cstr, uint8_t byte)
+{
+	return cbor_gen_add(cstr, &byte, 1);
+}
+
+/* Writes the initial byte of an item with its argument to p, in the fewest bytes
+ * possible (at most 9), and returns the number of bytes written
+ */
+static inline int cbor_gen_put_head(uint8_t *p, uint8_t major, uint64_t val)
+{
+	int len;
+	if (val < 24) {
+		p[0] = major << 5 | val;
+		return 1;
+	} else if (val <= 0xff) {
+		p[0] = major << 5 | 24;
+		len = 1;
+	} else if (val <= 0xffff) {
+		p[0] = major << 5 | 25;
+		len = 2;
+	} else if (val <= 0xffffffff) {
+		p[0] = major << 5 | 26;
+		len = 4;
+	} else {
+		p[0] = major << 5 | 27;
+		len = 8;
+	}
+	for (int i = len; i > 0; i--) {
+		p[i] = val;
+		val >>= 8;
+	}
+	return len + 1;
+}
+
+static int cbor_gen_add_head(cbor_gen_str_t *cstr, uint8_t major, uint64_t val)
+{
+	uint8_t head[9];
+	return cbor_gen_add(cstr, head, cbor_gen_put_head(head, major, val));
+}
+
+static int cbor_gen_add_text(cbor_gen_str_t *cstr, const char *str, int len)
+{
+	int ret = cbor_gen_add_head(cstr, CBOR_TEXT, len);
+	return ret | cbor_gen_add(cstr, str, len);
+}
+
+/* Converts val to half precision, if that holds it exactly */
+static bool cbor_gen_float_to_half(float val, uint16_t *half)
+{
+	uint32_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	uint16_t sign = (bits >> 16) & 0x8000;
+	int exp = (bits >> 23) & 0xff;
+	uint32_t mant = bits & 0x7fffff;
+	if (exp == 0xff) {
+		/* Infinity, or the canonical NaN */
+		*half = sign | 0x7c00 | (mant ? 0x200 : 0);
+		return true;
+	}
+	if (exp == 0 && mant == 0) {
+		*half = sign;
+		return true;
+	}
+	int e = exp - 127;
+	if (e >= -14 && e <= 15) {
+		if (mant & 0x1fff)
+			return false;
+		*half = sign | (e + 15) << 10 | mant >> 13;
+		return true;
+	}
+	if (e >= -24 && e < -14) {
+		/* Subnormal in half precision */
+		uint32_t full = mant | 0x800000;
+		int shift = -1 - e;
+		if (full & ((1u << shift) - 1))
+			return false;
+		*half = sign | full >> shift;
+		return true;
+	}
+	return false;
+}
+
+/* Writes val to p (at most 5 bytes) and returns the number of bytes written */
+static inline int cbor_gen_put_float(uint8_t *p, float val)
+{
+	uint16_t half;
+	if (cbor_gen_float_to_half(val, &half)) {
+		p[0] = CBOR_HALF;
+		p[1] = half >> 8;
+		p[2] = half;
+		return 3;
+	}
+	uint32_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	p[0] = CBOR_SINGLE;
+	p[1] = bits >> 24;
+	p[2] = bits >> 16;
+	p[3] = bits >> 8;
+	p[4] = bits;
+	return 5;
+}
+
+static inline int cbor_gen_put_int64(uint8_t *p, int64_t val)
+{
+	if (val < 0)
+		return cbor_gen_put_head(p, CBOR_NEGINT, (uint64_t)(-1 - val));
+	return cbor_gen_put_head(p, CBOR_UINT, val);
+}
+
+static int cbor_gen_add_float(cbor_gen_str_t *cstr, float val)
+{
+	uint8_t buf[5];
+	return cbor_gen_add(cstr, buf, cbor_gen_put_float(buf, val));
+}
+
+static int cbor_gen_add_int64(cbor_gen_str_t *cstr, int64_t val)
+{
+	uint8_t buf[9];
+	return cbor_gen_add(cstr, buf, cbor_gen_put_int64(buf, val));
+}
+
+void cbor_gen_str_start(cbor_gen_str_t *cstr, uint8_t *buf, int buf_size,
+		cbor_gen_flush_cb_t flush_cb, void *priv)
+{
+	memset(cstr, 0, sizeof(cbor_gen_str_t));
+	cstr->buf = buf;
+	cstr->buf_size = buf_size;
+	cstr->flush_cb = flush_cb;
+	cstr->free_ptr = buf;
+	cstr->priv = priv;
+}
+
+int cbor_gen_str_end(cbor_gen_str_t *cstr)
+{
+	int total_len = cstr->total_len;
+	if (cstr->buf && cstr->flush_cb && cstr->free_ptr != cstr->buf)
+		cstr->flush_cb(cstr->buf, cstr->free_ptr - cstr->buf, cstr->priv);
+	memset(cstr, 0, sizeof(cbor_gen_str_t));
+	return total_len;
+}
+
+int cbor_gen_start_object(cbor_gen_str_t *cstr)
+{
+	return cbor_gen_add_byte(cstr, CBOR_INDEFINITE_MAP);
+}
+
+int cbor_gen_end_object(cbor_gen_str_t *cstr)
+{
+	return cbor_gen_add_byte(cstr, CBOR_BREAK);
+}
+
+int cbor_gen_start_array(cbor_gen_str_t *cstr)
+{
+	return cbor_gen_add_byte(cstr, CBOR_INDEFINITE_ARRAY);
+}
+
+int cbor_gen_end_array(cbor_gen_str_t *cstr)
+{
+	return cbor_gen_add_byte(cstr, CBOR_BREAK);
+}
+
+int cbor_gen_push_object_n(cbor_gen_str_t *cstr, const char *name, int name_len)
+{
+	int ret = cbor_gen_add_text(cstr, name, name_len);
+	return ret | cbor_gen_add_byte(cstr, CBOR_INDEFINITE_MAP);
+}
+
+int cbor_gen_push_object(cbor_gen_str_t *cstr, char *name)
+{
+	return cbor_gen_push_object_n(cstr, name, strlen(name));
+}
+
+int cbor_gen_pop_object(cbor_gen_str_t *cstr)
+{
+	return cbor_gen_add_byte(cstr, CBOR_BREAK);
+}
+
+int cbor_gen_push_array_n(cbor_gen_str_t *cstr, const char *name, int name_len)
+{
+	int ret = cbor_gen_add_text(cstr, name, name_len);
+	return ret | cbor_gen_add_byte(cstr, CBOR_INDEFINITE_ARRAY);
+}
+
+int cbor_gen_push_array(cbor_gen_str_t *cstr, char *name)
+{
+	return cbor_gen_push_array_n(cstr, name, strlen(name));
+}
+
+int cbor_gen_pop_array(cbor_gen_str_t *cstr)
+{
+	return cbor_gen_add_byte(cstr, CBOR_BREAK);
+}
+
+int cbor_gen_obj_set_bool_n(cbor_gen_str_t *cstr, const char *name, int name_len, bool val)
+{
+	int ret = cbor_gen_add_text(cstr, name, name_len);
+	return ret | cbor_gen_arr_set_bool(cstr, val);
+}
+
+int cbor_gen_obj_set_bool(cbor_gen_str_t *cstr, char *name, bool val)
+{
+	return cbor_gen_obj_set_bool_n(cstr, name, strlen(name), val);
+}
+
+int cbor_gen_obj_set_int_n(cbor_gen_str_t *cstr, const char *name, int name_len, int val)
+{
+	int ret = cbor_gen_add_text(cstr, name, name_len);
+	return ret | cbor_gen_add_int64(cstr, val);
+}
+
+int cbor_gen_obj_set_int(cbor_gen_str_t *cstr, char *name, int val)
+{
+	return cbor_gen_obj_set_int_n(cstr, name, strlen(name), val);
+}
+
+int cbor_gen_obj_set_float_n(cbor_gen_str_t *cstr, const char *name, int name_len, float val)
+{
+	int ret = cbor_gen_add_text(cstr, name, name_len);
+	return ret | cbor_gen_add_float(cstr, val);
+}
+
+int cbor_gen_obj_set_float(cbor_gen_str_t *cstr, char *name, float val)
+{
+	return cbor_gen_obj_set_float_n(cstr, name, strlen(name), val);
+}
+
+int cbor_gen_obj_set_string_n(cbor_gen_str_t *cstr, const char *name, int name_len,
+		const char *val, int val_len)
+{
+	int ret = cbor_gen_add_text(cstr, name, name_len);
+	return ret | cbor_gen_arr_set_string_n(cstr, val, val_len);
+}
+
+int cbor_gen_obj_set_string(cbor_gen_str_t *cstr, char *name, char *val)
+{
+	return cbor_gen_obj_set_string_n(cstr, name, strlen(name), val, val ? strlen(val) : 0);
+}
+
+int cbor_gen_obj_set_null_n(cbor_gen_str_t *cstr, const char *name, int name_len)
+{
+	int ret = cbor_gen_add_text(cstr, name, name_len);
+	return ret | cbor_gen_add_byte(cstr, CBOR_NULL);
+}
+
+int cbor_gen_obj_set_null(cbor_gen_str_t *cstr, char *name)
+{
+	return cbor_gen_obj_set_null_n(cstr, name, strlen(name));
+}
+
+int cbor_gen_arr_set_bool(cbor_gen_str_t *cstr, bool val)
+{
+	return cbor_gen_add_byte(cstr, val ? CBOR_TRUE : CBOR_FALSE);
+}
+
+int cbor_gen_arr_set_int(cbor_gen_str_t *cstr, int val)
+{
+	return cbor_gen_add_int64(cstr, val);
+}
+
+int cbor_gen_arr_set_float(cbor_gen_str_t *cstr, float val)
+{
+	return cbor_gen_add_float(cstr, val);
+}
+
+int cbor_gen_arr_set_string_n(cbor_gen_str_t *cstr, const char *val, int val_len)
+{
+	return cbor_gen_add_text(cstr, val, val_len);
+}
+
+int cbor_gen_arr_set_string(cbor_gen_str_t *cstr, char *val)
+{
+	return cbor_gen_arr_set_string_n(cstr, val, val ? strlen(val) : 0);
+}
+
+int cbor_gen_arr_set_null(cbor_gen_str_t *cstr)
+{
+	return cbor_gen_add_byte(cstr, CBOR_NULL);
+}
+
+int cbor_gen_obj_start_long_string(cbor_gen_str_t *cstr, char *name, char *val)
+{
+	int ret = cbor_gen_add_text(cstr, name, strlen(name));
+	return ret | cbor_gen_arr_start_long_string(cstr, val);
+}
+
+int cbor_gen_arr_start_long_string(cbor_gen_str_t *cstr, char *val)
+{
+	int ret = cbor_gen_add_byte(cstr, CBOR_INDEFINITE_TEXT);
+	return ret | cbor_gen_add_to_long_string(cstr, val);
+}
+
+int cbor_gen_add_to_long_string(cbor_gen_str_t *cstr, char *val)
+{
+	/* Empty chunks are allowed, but pointless */
+	if (!val || !*val) {
+		return 0;
+	}
+	return cbor_gen_add_text(cstr, val, strlen(val));
+}
+
+int cbor_gen_end_long_string(cbor_gen_str_t *cstr)
+{
+	return cbor_gen_add_byte(cstr, CBOR_BREAK);
+}
+
+typedef enum {
+	CBOR_GEN_INT,
+	CBOR_GEN_INT64,
+	CBOR_GEN_FLOAT,
+} cbor_gen_num_type_t;
+
+/* Adds numbers one after another. When the buffer has room for all of them at
+ * their largest, they are written straight into it.
+ */
+static int cbor_gen_add_num_array(cbor_gen_str_t *cstr, cbor_gen_num_type_t type, const void *vals, int count)
+{
+	int max_len = type == CBOR_GEN_FLOAT ? 5 : 9;
+	int ret = 0;
+	if (cstr->buf && cstr->buf_size - (cstr->free_ptr - cstr->buf) >= (int64_t)max_len * count) {
+		uint8_t *p = cstr->free_ptr;
+		for (int i = 0; i < count; i++) {
+			if (type == CBOR_GEN_INT)
+				p += cbor_gen_put_int64(p, ((const int *)vals)[i]);
+			else if (type == CBOR_GEN_INT64)
+				p += cbor_gen_put_int64(p, ((const int64_t *)vals)[i]);
+			else
+				p += cbor_gen_put_float(p, ((const float *)vals)[i]);
+		}
+		cstr->total_len += p - cstr->free_ptr;
+		cstr->free_ptr = p;
+		return 0;
+	}
+	for (int i = 0; i < count && ret == 0; i++) {
+		if (type == CBOR_GEN_INT)
+			ret = cbor_gen_add_int64(cstr, ((const int *)vals)[i]);
+		else if (type == CBOR_GEN_INT64)
+			ret = cbor_gen_add_int64(cstr, ((const int64_t *)vals)[i]);
+		else
+			ret = cbor_gen_add_float(cstr, ((const float *)vals)[i]);
+	}
+	return ret;
+}
+
+int cbor_gen_arr_set_int_array(cbor_gen_str_t *cstr, const int *vals, int count)
+{
+	return cbor_gen_add_num_array(cstr, CBOR_GEN_INT, vals, count);
+}
+
+int cbor_gen_arr_set_int64_array(cbor_gen_str_t *cstr, const int64_t *vals, int count)
+{
+	return cbor_gen_add_num_array(cstr, CBOR_GEN_INT64, vals, count);
+}
+
+int cbor_gen_arr_set_float_array(cbor_gen_str_t *cstr, const float *vals, int count)
+{
+	return cbor_gen_add_num_array(cstr, CBOR_GEN_FLOAT, vals, count);
+}
+
+static int cbor_gen_push_array_len(cbor_gen_str_t *cstr, char *name, int count)
+{
+	int ret = cbor_gen_add_text(cstr, name, strlen(name));
+	return ret | cbor_gen_add_head(cstr, CBOR_ARRAY, count < 0 ? 0 : count);
+}
+
+int cbor_gen_obj_set_int_array(cbor_gen_str_t *cstr, char *name, const int *vals, int count)
+{
+	int ret = cbor_gen_push_array_len(cstr, name, count);
+	return ret | cbor_gen_arr_set_int_array(cstr, vals, count);
+}
+
+int cbor_gen_obj_set_int64_array(cbor_gen_str_t *cstr, char *name, const int64_t *vals, int count)
+{
+	int ret = cbor_gen_push_array_len(cstr, name, count);
+	return ret | cbor_gen_arr_set_int64_array(cstr, vals, count);
+}
+
+int cbor_gen_obj_set_float_array(cbor_gen_str_t *cstr, char *name, const float *vals, int count)
+{
+	int ret = cbor_gen_push_array_len(cstr, name, count);
+	return ret | cbor_gen_arr_set_float_array(cstr, vals, count);
+}
@@ -0,0 +1,139 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * CBOR (RFC 8949) Generator
+ *
+ * The same calls as the JSON generator, with cbor_gen_ in place of json_gen_,
+ * but giving CBOR instead of JSON text. Objects and arrays are written with
+ * indefinite lengths, so that they need not be known in advance, and floats
+ * take 3 bytes when half precision holds them exactly and 5 bytes otherwise.
+ * Floats are never rounded, so there are no precision settings.
+ *
+ * A payload can then be switched between the two formats at build time by
+ * picking the prefix, e.g.
+ *
+ *     #if USE_CBOR
+ *     #define GEN(fn) cbor_gen_##fn
+ *     #else
+ *     #define GEN(fn) json_gen_##fn
+ *     #endif
+ *     GEN(obj_set_float)(&gstr, "temp", 23.5);
+ */
+#ifndef _CBOR_GENERATOR_H
+#define _CBOR_GENERATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** CBOR flush callback prototype
+ *
+ * Same as json_gen_flush_cb_t, but with the length, since CBOR is binary
+ *
+ * \param[in] buf Pointer to the CBOR data
+ * \param[in] len Length of the data
+ * \param[in] priv Private data passed to cbor_gen_str_start()
+ */
+typedef void (*cbor_gen_flush_cb_t) (uint8_t *buf, int len, void *priv);
+
+/** CBOR generator structure
+ *
+ * Please do not set/modify any elements.
+ * Just define this structure and pass a pointer to it in the APIs below
+ */
+typedef struct {
+	uint8_t *buf;
+	int buf_size;
+	cbor_gen_flush_cb_t flush_cb;
+	void *priv;
+	uint8_t *free_ptr;
+	int total_len;
+} cbor_gen_str_t;
+
+/** Start CBOR data
+ *
+ * Same as json_gen_str_start(). The buffer is flushed out when full if a
+ * callback is given, else the APIs return -1.
+ */
+void cbor_gen_str_start(cbor_gen_str_t *cstr, uint8_t *buf, int buf_size,
+		cbor_gen_flush_cb_t flush_cb, void *priv);
+
+/** End CBOR data
+ *
+ * \return Total length of the CBOR data. Unlike json_gen_str_end(), there is
+ * no NULL termination.
+ */
+int cbor_gen_str_end(cbor_gen_str_t *cstr);
+
+/* The functions below behave like their json_gen_ counterparts, returning
+ * 0 on success and -1 if the buffer is out of space (only possible if no
+ * flush callback was passed to cbor_gen_str_start())
+ */
+int cbor_gen_start_object(cbor_gen_str_t *cstr);
+int cbor_gen_end_object(cbor_gen_str_t *cstr);
+int cbor_gen_start_array(cbor_gen_str_t *cstr);
+int cbor_gen_end_array(cbor_gen_str_t *cstr);
+int cbor_gen_push_object_n(cbor_gen_str_t *cstr, const char *name, int name_len);
+int cbor_gen_push_object(cbor_gen_str_t *cstr, char *name);
+int cbor_gen_pop_object(cbor_gen_str_t *cstr);
+int cbor_gen_push_array_n(cbor_gen_str_t *cstr, const char *name, int name_len);
+int cbor_gen_push_array(cbor_gen_str_t *cstr, char *name);
+int cbor_gen_pop_array(cbor_gen_str_t *cstr);
+
+int cbor_gen_obj_set_bool_n(cbor_gen_str_t *cstr, const char *name, int name_len, bool val);
+int cbor_gen_obj_set_bool(cbor_gen_str_t *cstr, char *name, bool val);
+int cbor_gen_obj_set_int_n(cbor_gen_str_t *cstr, const char *name, int name_len, int val);
+int cbor_gen_obj_set_int(cbor_gen_str_t *cstr, char *name, int val);
+int cbor_gen_obj_set_float_n(cbor_gen_str_t *cstr, const char *name, int name_len, float val);
+int cbor_gen_obj_set_float(cbor_gen_str_t *cstr, char *name, float val);
+int cbor_gen_obj_set_string_n(cbor_gen_str_t *cstr, const char *name, int name_len,
+		const char *val, int val_len);
+int cbor_gen_obj_set_string(cbor_gen_str_t *cstr, char *name, char *val);
+int cbor_gen_obj_set_null_n(cbor_gen_str_t *cstr, const char *name, int name_len);
+int cbor_gen_obj_set_null(cbor_gen_str_t *cstr, char *name);
+
+int cbor_gen_arr_set_bool(cbor_gen_str_t *cstr, bool val);
+int cbor_gen_arr_set_int(cbor_gen_str_t *cstr, int val);
+int cbor_gen_arr_set_float(cbor_gen_str_t *cstr, float val);
+int cbor_gen_arr_set_string_n(cbor_gen_str_t *cstr, const char *val, int val_len);
+int cbor_gen_arr_set_string(cbor_gen_str_t *cstr, char *val);
+int cbor_gen_arr_set_null(cbor_gen_str_t *cstr);
+
+/* Long strings are written as indefinite length strings, one chunk per call */
+int cbor_gen_obj_start_long_string(cbor_gen_str_t *cstr, char *name, char *val);
+int cbor_gen_arr_start_long_string(cbor_gen_str_t *cstr, char *val);
+int cbor_gen_add_to_long_string(cbor_gen_str_t *cstr, char *val);
+int cbor_gen_end_long_string(cbor_gen_str_t *cstr);
+
+/* Arrays of numbers, as with json_gen_obj_set_int_array() and so on. The named
+ * ones get a definite length.
+ */
+int cbor_gen_obj_set_int_array(cbor_gen_str_t *cstr, char *name, const int *vals, int count);
+int cbor_gen_obj_set_int64_array(cbor_gen_str_t *cstr, char *name, const int64_t *vals, int count);
+int cbor_gen_obj_set_float_array(cbor_gen_str_t *cstr, char *name, const float *vals, int count);
+int cbor_gen_arr_set_int_array(cbor_gen_str_t *cstr, const int *vals, int count);
+int cbor_gen_arr_set_int64_array(cbor_gen_str_t *cstr, const int64_t *vals, int count);
+int cbor_gen_arr_set_float_array(cbor_gen_str_t *cstr, const float *vals, int count);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -14,60 +14,225 @@
  *   limitations under the License.
  */
 
-#include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdarg.h>
 
 #include <json_generator.h>
 
 #define MAX_INT_IN_STR  	24
-#define MAX_FLOAT_IN_STR 	30
+/* Sign, 39 integer digits of FLT_MAX, point and JSON_FLOAT_MAX_PRECISION digits */
+#define MAX_FLOAT_IN_STR 	64
 
 static inline int json_gen_get_empty_len(json_gen_str_t *jstr)
 {
 	return (jstr->buf_size - (jstr->free_ptr - jstr->buf) - 1);
 }
 
-/* This will add the incoming string to the JSON string buffer
- * and flush it out if the buffer is full. Note that the data being
+/* This will add the incoming string of known length to the JSON string
+ * buffer and flush it out if the buffer is full. Note that the data being
  * flushed out will always be equal to the size of the buffer unless
  * this is the last chunk being flushed out on json_gen_end_str()
  */
-static int json_gen_add_to_str(json_gen_str_t *jstr, char *str)
+static int json_gen_iov_add(json_gen_str_t *jstr, const char *str, int len, bool copy);
+
+/* Flushes out the buffer. In asynchronous mode, the filled half is handed over
+ * once the previous flush (of the other half) has completed, and filling then
+ * continues in the other half.
+ */
+static int json_gen_flush(json_gen_str_t *jstr)
 {
-    if (!str) {
-        return 0;
-    }
-	int len = strlen(str);
-    jstr->total_len += len;
-    if (jstr->buf == NULL) {
-        return 0;
-    }
-	char *cur_ptr = str;
+	*jstr->free_ptr = '\0';
+	if (jstr->async_flush_cb) {
+		if (jstr->flush_pending)
+			jstr->wait_cb(jstr->priv);
+		jstr->async_flush_cb(jstr->buf, jstr->free_ptr - jstr->buf, jstr->priv);
+		jstr->flush_pending = true;
+		char *buf = jstr->alt_buf;
+		jstr->alt_buf = jstr->buf;
+		jstr->buf = buf;
+	} else if (jstr->flush_cb) {
+		jstr->flush_cb(jstr->buf, jstr->priv);
+	} else {
+		return -1;
+	}
+	jstr->free_ptr = jstr->buf;
+	return 0;
+}
+
+static int json_gen_add_to_str_n(json_gen_str_t *jstr, const char *str, int len)
+{
+	if (jstr->iov) {
+		return json_gen_iov_add(jstr, str, len, true);
+	}
+	jstr->total_len += len;
+	if (jstr->buf == NULL) {
+		return 0;
+	}
+	const char *cur_ptr = str;
 	while (1) {
 		int len_remaining = json_gen_get_empty_len(jstr);
 		int copy_len = len_remaining > len ? len : len_remaining;
-		memmove(jstr->free_ptr, cur_ptr, copy_len);
+		memcpy(jstr->free_ptr, cur_ptr, copy_len);
 		cur_ptr += copy_len;
 		jstr->free_ptr += copy_len;
 		len -= copy_len;
 		if (len) {
-			*jstr->free_ptr = '\0';
 			/* Report error if the buffer is full and no flush callback
 			 * is registered
 			 */
-			if (!jstr->flush_cb) {
+			if (json_gen_flush(jstr) != 0) {
+				jstr->overflow = true;
 				return -1;
 			}
-			jstr->flush_cb(jstr->buf, jstr->priv);
-			jstr->free_ptr = jstr->buf;
 		} else
 			break;
 	}
 	return 0;
 }
 
+/* For string literals only */
+#define json_gen_add_literal(jstr, str) json_gen_add_to_str_n(jstr, str, sizeof(str) - 1)
+
+/* Hands the segments collected so far to the flush callback and starts over with
+ * an empty scratch area
+ */
+static int json_gen_iov_flush(json_gen_str_t *jstr)
+{
+	if (!jstr->iov_flush_cb || !jstr->iov_cnt)
+		return -1;
+	jstr->iov_flush_cb(jstr->iov, jstr->iov_cnt, jstr->priv);
+	jstr->iov_cnt = 0;
+	jstr->free_ptr = jstr->buf;
+	return 0;
+}
+
+/* Adds data in scatter-gather mode, either by reference or copied to the scratch
+ * area. A segment which directly follows the last one just extends it.
+ */
+static int json_gen_iov_add(json_gen_str_t *jstr, const char *str, int len, bool copy)
+{
+	jstr->total_len += len;
+	while (len) {
+		const char *base = str;
+		int seg_len = len;
+		if (copy) {
+			int space = jstr->buf_size - (jstr->free_ptr - jstr->buf);
+			if (!space) {
+				if (json_gen_iov_flush(jstr) != 0)
+					return -1;
+				continue;
+			}
+			base = jstr->free_ptr;
+			if (seg_len > space)
+				seg_len = space;
+		}
+		json_gen_iov_t *seg = jstr->iov_cnt ? &jstr->iov[jstr->iov_cnt - 1] : NULL;
+		if (!seg || seg->base + seg->len != base) {
+			/* Flushing resets the scratch area, so nothing is copied before this */
+			if (jstr->iov_cnt == jstr->iov_max) {
+				if (json_gen_iov_flush(jstr) != 0)
+					return -1;
+				continue;
+			}
+			seg = &jstr->iov[jstr->iov_cnt++];
+			seg->base = base;
+			seg->len = 0;
+		}
+		if (copy) {
+			memcpy(jstr->free_ptr, str, seg_len);
+			jstr->free_ptr += seg_len;
+		}
+		seg->len += seg_len;
+		str += seg_len;
+		len -= seg_len;
+	}
+	return 0;
+}
+
+/* For data which stays valid until it has been flushed out, like names and template
+ * text. Long enough fragments are referenced instead of copied in scatter-gather mode.
+ */
+static int json_gen_add_ref_n(json_gen_str_t *jstr, const char *str, int len)
+{
+	if (jstr->iov && len >= JSON_GEN_IOV_MIN_REF) {
+		return json_gen_iov_add(jstr, str, len, false);
+	}
+	return json_gen_add_to_str_n(jstr, str, len);
+}
+
+/* Character to follow the backslash for the bytes to be escaped in strings,
+ * with 'u' for the ones to be written as \u00XX
+ */
+static const char json_gen_escape_table[256] = {
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+	['"'] = '"',
+	['\\'] = '\\',
+};
+
+typedef size_t json_gen_word_t;
+
+#define JSON_GEN_WORD_ONES	((json_gen_word_t)-1 / 0xff)
+#define JSON_GEN_WORD_HIGHS	(JSON_GEN_WORD_ONES * 0x80)
+
+/* Whether any byte of the word is a control character, quote or backslash */
+static inline bool json_gen_word_needs_escape(json_gen_word_t w)
+{
+	json_gen_word_t quote = w ^ (JSON_GEN_WORD_ONES * '"');
+	json_gen_word_t backslash = w ^ (JSON_GEN_WORD_ONES * '\\');
+	return ((w - JSON_GEN_WORD_ONES * 0x20) & ~w & JSON_GEN_WORD_HIGHS)
+		| ((quote - JSON_GEN_WORD_ONES) & ~quote & JSON_GEN_WORD_HIGHS)
+		| ((backslash - JSON_GEN_WORD_ONES) & ~backslash & JSON_GEN_WORD_HIGHS);
+}
+
+/* Adds string contents with escaping. Runs of bytes which need no escaping are
+ * found a word at a time and copied in one go.
+ */
+static int json_gen_add_escaped_n(json_gen_str_t *jstr, const char *str, int len)
+{
+	const char *end = str + len;
+	const char *run = str;
+	const char *p = str;
+	int ret = 0;
+	while (p < end) {
+		json_gen_word_t w;
+		while (end - p >= (int)sizeof(w)) {
+			memcpy(&w, p, sizeof(w));
+			if (json_gen_word_needs_escape(w))
+				break;
+			p += sizeof(w);
+		}
+		while (p < end && !json_gen_escape_table[(uint8_t)*p])
+			p++;
+		if (p > run)
+			ret |= json_gen_add_to_str_n(jstr, run, p - run);
+		if (p == end)
+			break;
+		char esc[6] = {'\\', json_gen_escape_table[(uint8_t)*p]};
+		if (esc[1] == 'u') {
+			esc[2] = '0';
+			esc[3] = '0';
+			esc[4] = "0123456789abcdef"[(uint8_t)*p >> 4];
+			esc[5] = "0123456789abcdef"[*p & 0xf];
+			ret |= json_gen_add_to_str_n(jstr, esc, 6);
+		} else {
+			ret |= json_gen_add_to_str_n(jstr, esc, 2);
+		}
+		run = ++p;
+	}
+	return ret;
+}
+
+static int json_gen_add_to_str(json_gen_str_t *jstr, const char *str)
+{
+	if (!str) {
+		return 0;
+	}
+	return json_gen_add_ref_n(jstr, str, strlen(str));
+}
+
 
 void json_gen_str_start(json_gen_str_t *jstr, char *buf, int buf_size,
 		json_gen_flush_cb_t flush_cb, void *priv)
@@ -78,12 +243,44 @@ void json_gen_str_start(json_gen_str_t *jstr, char *buf, int buf_size,
 	jstr->flush_cb = flush_cb;
 	jstr->free_ptr = buf;
 	jstr->priv = priv;
+	jstr->mark_offset = -1;
+}
+
+void json_gen_str_start_async(json_gen_str_t *jstr, char *buf, int buf_size,
+		json_gen_async_flush_cb_t flush_cb, json_gen_flush_wait_cb_t wait_cb, void *priv)
+{
+	json_gen_str_start(jstr, buf, buf_size / 2, NULL, priv);
+	jstr->alt_buf = buf + buf_size / 2;
+	jstr->async_flush_cb = flush_cb;
+	jstr->wait_cb = wait_cb;
+}
+
+void json_gen_str_start_iov(json_gen_str_t *jstr, json_gen_iov_t *iov, int max_iov,
+		char *scratch, int scratch_size, json_gen_iov_flush_cb_t flush_cb, void *priv)
+{
+	json_gen_str_start(jstr, scratch, scratch_size, NULL, priv);
+	jstr->iov = iov;
+	jstr->iov_max = max_iov;
+	jstr->iov_flush_cb = flush_cb;
+}
+
+int json_gen_get_iov_count(json_gen_str_t *jstr)
+{
+	return jstr->iov_cnt;
 }
 
 int json_gen_str_end(json_gen_str_t *jstr)
 {
     int total_len = jstr->total_len;
-    if (jstr->buf) {
+    if (jstr->iov) {
+	    if (jstr->iov_flush_cb && jstr->iov_cnt)
+		    json_gen_iov_flush(jstr);
+    } else if (jstr->async_flush_cb) {
+	    if (jstr->free_ptr != jstr->buf)
+		    json_gen_flush(jstr);
+	    if (jstr->flush_pending)
+		    jstr->wait_cb(jstr->priv);
+    } else if (jstr->buf) {
 	    *jstr->free_ptr = '\0';
 	    if (jstr->flush_cb)
 		    jstr->flush_cb(jstr->buf, jstr->priv);
@@ -92,18 +289,51 @@ int json_gen_str_end(json_gen_str_t *jstr)
     return total_len + 1; /* +1 for the NULL termination */
 }
 
+/* Keeps track of the open containers, for json_gen_rollback() */
+static inline void json_gen_nest_push(json_gen_str_t *jstr, bool is_array)
+{
+	if (jstr->depth < JSON_GEN_MAX_NESTING) {
+		if (is_array)
+			jstr->nest_types |= 1U << jstr->depth;
+		else
+			jstr->nest_types &= ~(1U << jstr->depth);
+	}
+	jstr->depth++;
+}
+
+static inline void json_gen_nest_pop(json_gen_str_t *jstr)
+{
+	if (jstr->depth)
+		jstr->depth--;
+}
+
 static inline void json_gen_handle_comma(json_gen_str_t *jstr)
 {
 	if (jstr->comma_req)
-		json_gen_add_to_str(jstr, ",");
+		json_gen_add_literal(jstr, ",");
 }
 
-
-static int json_gen_handle_name(json_gen_str_t *jstr, char *name)
+/* Adds the optional comma and "name": in a single copy whenever they fit in the buffer */
+static int json_gen_handle_name(json_gen_str_t *jstr, const char *name, int name_len)
 {
-	json_gen_add_to_str(jstr, "\"");
-	json_gen_add_to_str(jstr, name);
-	return json_gen_add_to_str(jstr, "\":");
+	int len = name_len + 3 + (jstr->comma_req ? 1 : 0);
+	if (jstr->buf && !jstr->iov && len <= json_gen_get_empty_len(jstr)) {
+		char *p = jstr->free_ptr;
+		if (jstr->comma_req)
+			*p++ = ',';
+		*p++ = '"';
+		memcpy(p, name, name_len);
+		p += name_len;
+		*p++ = '"';
+		*p++ = ':';
+		jstr->free_ptr = p;
+		jstr->total_len += len;
+		return 0;
+	}
+	json_gen_handle_comma(jstr);
+	json_gen_add_literal(jstr, "\"");
+	json_gen_add_ref_n(jstr, name, name_len);
+	return json_gen_add_literal(jstr, "\":");
 }
 
 
@@ -111,13 +341,15 @@ int json_gen_start_object(json_gen_str_t *jstr)
 {
 	json_gen_handle_comma(jstr);
 	jstr->comma_req = false;
-	return json_gen_add_to_str(jstr, "{");
+	json_gen_nest_push(jstr, false);
+	return json_gen_add_literal(jstr, "{");
 }
 
 int json_gen_end_object(json_gen_str_t *jstr)
 {
 	jstr->comma_req = true;
-	return json_gen_add_to_str(jstr, "}");
+	json_gen_nest_pop(jstr);
+	return json_gen_add_literal(jstr, "}");
 }
 
 
@@ -125,152 +357,766 @@ int json_gen_start_array(json_gen_str_t *jstr)
 {
 	json_gen_handle_comma(jstr);
 	jstr->comma_req = false;
-	return json_gen_add_to_str(jstr, "[");
+	json_gen_nest_push(jstr, true);
+	return json_gen_add_literal(jstr, "[");
 }
 
 int json_gen_end_array(json_gen_str_t *jstr)
 {
 	jstr->comma_req = true;
-	return json_gen_add_to_str(jstr, "]");
+	json_gen_nest_pop(jstr);
+	return json_gen_add_literal(jstr, "]");
 }
 
-int json_gen_push_object(json_gen_str_t *jstr, char *name)
+int json_gen_push_object_n(json_gen_str_t *jstr, const char *name, int name_len)
 {
-	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
+	json_gen_handle_name(jstr, name, name_len);
 	jstr->comma_req = false;
-	return json_gen_add_to_str(jstr, "{");
+	json_gen_nest_push(jstr, false);
+	return json_gen_add_literal(jstr, "{");
+}
+
+int json_gen_push_object(json_gen_str_t *jstr, char *name)
+{
+	return json_gen_push_object_n(jstr, name, strlen(name));
 }
 
 int json_gen_pop_object(json_gen_str_t *jstr)
 {
 	jstr->comma_req = true;
-	return json_gen_add_to_str(jstr, "}");
+	json_gen_nest_pop(jstr);
+	return json_gen_add_literal(jstr, "}");
 }
 
 int json_gen_push_object_str(json_gen_str_t *jstr, char *name, char *object_str)
 {
-	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
+	json_gen_handle_name(jstr, name, strlen(name));
 	jstr->comma_req = true;
 	return json_gen_add_to_str(jstr, object_str);
 }
 
-int json_gen_push_array(json_gen_str_t *jstr, char *name)
+int json_gen_push_array_n(json_gen_str_t *jstr, const char *name, int name_len)
 {
-	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
+	json_gen_handle_name(jstr, name, name_len);
 	jstr->comma_req = false;
-	return json_gen_add_to_str(jstr, "[");
+	json_gen_nest_push(jstr, true);
+	return json_gen_add_literal(jstr, "[");
 }
+
+int json_gen_push_array(json_gen_str_t *jstr, char *name)
+{
+	return json_gen_push_array_n(jstr, name, strlen(name));
+}
+
 int json_gen_pop_array(json_gen_str_t *jstr)
 {
 	jstr->comma_req = true;
-	return json_gen_add_to_str(jstr, "]");
+	json_gen_nest_pop(jstr);
+	return json_gen_add_literal(jstr, "]");
 }
 
 int json_gen_push_array_str(json_gen_str_t *jstr, char *name, char *array_str)
 {
-	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
+	json_gen_handle_name(jstr, name, strlen(name));
 	jstr->comma_req = true;
 	return json_gen_add_to_str(jstr, array_str);
 }
 
+/* Marks can only be rolled back to when the whole string is still in the buffer */
+static bool json_gen_can_rollback(json_gen_str_t *jstr)
+{
+	return jstr->buf && !jstr->flush_cb && !jstr->async_flush_cb && !jstr->iov;
+}
+
+int json_gen_mark(json_gen_str_t *jstr)
+{
+	/* Room for closing all the open containers is kept after every mark */
+	if (!json_gen_can_rollback(jstr) || jstr->overflow || jstr->depth > JSON_GEN_MAX_NESTING
+			|| json_gen_get_empty_len(jstr) < jstr->depth)
+		return -1;
+	jstr->mark_offset = jstr->free_ptr - jstr->buf;
+	jstr->mark_comma_req = jstr->comma_req;
+	jstr->mark_nest_types = jstr->nest_types;
+	jstr->mark_depth = jstr->depth;
+	return 0;
+}
+
+int json_gen_rollback(json_gen_str_t *jstr)
+{
+	if (!json_gen_can_rollback(jstr) || jstr->mark_offset < 0)
+		return -1;
+	char *p = jstr->buf + jstr->mark_offset;
+	for (int i = jstr->mark_depth - 1; i >= 0; i--)
+		*p++ = (jstr->mark_nest_types & (1U << i)) ? ']' : '}';
+	jstr->free_ptr = p;
+	/* Nothing was flushed out, so this is all there is */
+	jstr->total_len = p - jstr->buf;
+	jstr->comma_req = jstr->mark_depth ? true : jstr->mark_comma_req;
+	jstr->depth = 0;
+	jstr->overflow = false;
+	return 0;
+}
+
 static int json_gen_set_bool(json_gen_str_t *jstr, bool val)
 {
 	jstr->comma_req = true;
 	if (val)
-		return json_gen_add_to_str(jstr, "true");
+		return json_gen_add_literal(jstr, "true");
 	else
-		return json_gen_add_to_str(jstr, "false");
+		return json_gen_add_literal(jstr, "false");
 }
-int json_gen_obj_set_bool(json_gen_str_t *jstr, char *name, bool val)
+
+int json_gen_obj_set_bool_n(json_gen_str_t *jstr, const char *name, int name_len, bool val)
 {
-	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
+	json_gen_handle_name(jstr, name, name_len);
 	return json_gen_set_bool(jstr, val);
 }
 
+int json_gen_obj_set_bool(json_gen_str_t *jstr, char *name, bool val)
+{
+	return json_gen_obj_set_bool_n(jstr, name, strlen(name), val);
+}
+
 int json_gen_arr_set_bool(json_gen_str_t *jstr, bool val)
 {
 	json_gen_handle_comma(jstr);
 	return json_gen_set_bool(jstr, val);
 }
 
+static const char json_gen_digit_pairs[200] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/* Writes val in decimal backwards, ending just before end, and returns the first digit */
+static char *json_gen_u32_to_str(uint32_t val, char *end)
+{
+	while (val >= 100) {
+		uint32_t pair = (val % 100) * 2;
+		val /= 100;
+		*--end = json_gen_digit_pairs[pair + 1];
+		*--end = json_gen_digit_pairs[pair];
+	}
+	if (val >= 10) {
+		*--end = json_gen_digit_pairs[val * 2 + 1];
+		*--end = json_gen_digit_pairs[val * 2];
+	} else {
+		*--end = '0' + val;
+	}
+	return end;
+}
+
+/* Writes val to str (of MAX_INT_IN_STR bytes) and returns the length */
+static int json_gen_format_int(char *str, int val)
+{
+	char digits[MAX_INT_IN_STR];
+	char *end = digits + sizeof(digits);
+	char *start = json_gen_u32_to_str(val < 0 ? 0 - (uint32_t)val : (uint32_t)val, end);
+	if (val < 0)
+		*--start = '-';
+	memcpy(str, start, end - start);
+	return end - start;
+}
+
+/* Same as json_gen_format_int(), for 64 bit integers */
+static int json_gen_format_int64(char *str, int64_t val)
+{
+	char digits[MAX_INT_IN_STR];
+	char *end = digits + sizeof(digits);
+	char *start = end;
+	uint64_t u = val < 0 ? 0 - (uint64_t)val : (uint64_t)val;
+	/* Eight digits at a time, until the rest fits in 32 bits */
+	while (u > UINT32_MAX) {
+		char *chunk_end = start;
+		start = json_gen_u32_to_str(u % 100000000, start);
+		u /= 100000000;
+		while (chunk_end - start < 8)
+			*--start = '0';
+	}
+	start = json_gen_u32_to_str((uint32_t)u, start);
+	if (val < 0)
+		*--start = '-';
+	memcpy(str, start, end - start);
+	return end - start;
+}
+
 static int json_gen_set_int(json_gen_str_t *jstr, int val)
 {
 	jstr->comma_req = true;
 	char str[MAX_INT_IN_STR];
-	snprintf(str, MAX_INT_IN_STR, "%d", val);
-	return json_gen_add_to_str(jstr, str);
+	int len = json_gen_format_int(str, val);
+	return json_gen_add_to_str_n(jstr, str, len);
 }
 
-int json_gen_obj_set_int(json_gen_str_t *jstr, char *name, int val)
+int json_gen_obj_set_int_n(json_gen_str_t *jstr, const char *name, int name_len, int val)
 {
-	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
+	json_gen_handle_name(jstr, name, name_len);
 	return json_gen_set_int(jstr, val);
 }
 
+int json_gen_obj_set_int(json_gen_str_t *jstr, char *name, int val)
+{
+	return json_gen_obj_set_int_n(jstr, name, strlen(name), val);
+}
+
 int json_gen_arr_set_int(json_gen_str_t *jstr, int val)
 {
 	json_gen_handle_comma(jstr);
 	return json_gen_set_int(jstr, val);
 }
 
+static int json_gen_set_int64(json_gen_str_t *jstr, int64_t val)
+{
+	jstr->comma_req = true;
+	char str[MAX_INT_IN_STR];
+	int len = json_gen_format_int64(str, val);
+	return json_gen_add_to_str_n(jstr, str, len);
+}
+
+int json_gen_obj_set_int64_n(json_gen_str_t *jstr, const char *name, int name_len, int64_t val)
+{
+	json_gen_handle_name(jstr, name, name_len);
+	return json_gen_set_int64(jstr, val);
+}
 
-static int json_gen_set_float(json_gen_str_t *jstr, float val)
+int json_gen_obj_set_int64(json_gen_str_t *jstr, char *name, int64_t val)
+{
+	return json_gen_obj_set_int64_n(jstr, name, strlen(name), val);
+}
+
+int json_gen_arr_set_int64(json_gen_str_t *jstr, int64_t val)
+{
+	json_gen_handle_comma(jstr);
+	return json_gen_set_int64(jstr, val);
+}
+
+
+/* Exactly what printf("%.*f") gives, for precision up to JSON_FLOAT_MAX_PRECISION.
+ * The float is m * 2^e, so the integer and fractional parts can be worked out
+ * exactly with integer arithmetic, which is also how the digits get rounded.
+ */
+static int json_gen_float_to_fixed(char *str, bool neg, uint32_t m, int e, int precision)
+{
+	char *p = str;
+	if (neg)
+		*p++ = '-';
+	if (e >= 0) {
+		/* Up to 128 bits of integer and no fraction */
+		uint32_t limbs[4] = {0};
+		char chunks[5][9];
+		int num_chunks = 0;
+		uint64_t shifted = (uint64_t)m << (e % 32);
+		limbs[e / 32] = (uint32_t)shifted;
+		if (e / 32 < 3)
+			limbs[e / 32 + 1] = (uint32_t)(shifted >> 32);
+		int top = 3;
+		while (top >= 0) {
+			uint64_t rem = 0;
+			for (int i = top; i >= 0; i--) {
+				uint64_t cur = (rem << 32) | limbs[i];
+				limbs[i] = (uint32_t)(cur / 1000000000);
+				rem = cur % 1000000000;
+			}
+			char *end = chunks[num_chunks] + 9;
+			char *start = json_gen_u32_to_str((uint32_t)rem, end);
+			while (start > chunks[num_chunks])
+				*--start = '0';
+			num_chunks++;
+			while (top >= 0 && limbs[top] == 0)
+				top--;
+		}
+		/* The first chunk is printed without its leading zeros */
+		int i = 0;
+		while (i < 8 && chunks[num_chunks - 1][i] == '0')
+			i++;
+		memcpy(p, &chunks[num_chunks - 1][i], 9 - i);
+		p += 9 - i;
+		for (int c = num_chunks - 2; c >= 0; c--) {
+			memcpy(p, chunks[c], 9);
+			p += 9;
+		}
+		if (precision) {
+			*p++ = '.';
+			memset(p, '0', precision);
+			p += precision;
+		}
+		return p - str;
+	}
+
+	int shift = -e;
+	uint32_t int_part = shift < 32 ? m >> shift : 0;
+	char frac[JSON_FLOAT_MAX_PRECISION];
+	bool round_up = false;
+	memset(frac, '0', precision);
+	/* Anything below 2^-37 rounds to zero at this precision */
+	if (shift <= 60) {
+		uint64_t mask = ((uint64_t)1 << shift) - 1;
+		uint64_t rem = m & mask;
+		for (int i = 0; i < precision; i++) {
+			rem *= 10;
+			frac[i] = '0' + (char)(rem >> shift);
+			rem &= mask;
+		}
+		uint64_t half = (uint64_t)1 << (shift - 1);
+		int last = precision ? frac[precision - 1] - '0' : (int)int_part;
+		/* Ties go to even */
+		round_up = rem > half || (rem == half && (last & 1));
+	}
+	if (round_up) {
+		int i = precision - 1;
+		while (i >= 0 && frac[i] == '9')
+			frac[i--] = '0';
+		if (i >= 0)
+			frac[i]++;
+		else
+			int_part++;
+	}
+	char digits[MAX_INT_IN_STR];
+	char *end = digits + sizeof(digits);
+	char *start = json_gen_u32_to_str(int_part, end);
+	memcpy(p, start, end - start);
+	p += end - start;
+	if (precision) {
+		*p++ = '.';
+		memcpy(p, frac, precision);
+		p += precision;
+	}
+	return p - str;
+}
+
+/* Shortest round trip conversion, from Ryu (Ulf Adams, PLDI 2018). Gives the decimal
+ * with the fewest digits which still reads back as the same float, and the closest
+ * one to the exact value among those.
+ */
+#define FLOAT_MANTISSA_BITS 	23
+#define FLOAT_BIAS 		127
+#define FLOAT_POW5_INV_BITCOUNT	59
+#define FLOAT_POW5_BITCOUNT 	61
+
+static const uint64_t FLOAT_POW5_INV_SPLIT[31] = {
+	576460752303423489u, 461168601842738791u, 368934881474191033u, 295147905179352826u,
+	472236648286964522u, 377789318629571618u, 302231454903657294u, 483570327845851670u,
+	386856262276681336u, 309485009821345069u, 495176015714152110u, 396140812571321688u,
+	316912650057057351u, 507060240091291761u, 405648192073033409u, 324518553658426727u,
+	519229685853482763u, 415383748682786211u, 332306998946228969u, 531691198313966350u,
+	425352958651173080u, 340282366920938464u, 544451787073501542u, 435561429658801234u,
+	348449143727040987u, 557518629963265579u, 446014903970612463u, 356811923176489971u,
+	570899077082383953u, 456719261665907162u, 365375409332725730u
+};
+
+static const uint64_t FLOAT_POW5_SPLIT[47] = {
+	1152921504606846976u, 1441151880758558720u, 1801439850948198400u, 2251799813685248000u,
+	1407374883553280000u, 1759218604441600000u, 2199023255552000000u, 1374389534720000000u,
+	1717986918400000000u, 2147483648000000000u, 1342177280000000000u, 1677721600000000000u,
+	2097152000000000000u, 1310720000000000000u, 1638400000000000000u, 2048000000000000000u,
+	1280000000000000000u, 1600000000000000000u, 2000000000000000000u, 1250000000000000000u,
+	1562500000000000000u, 1953125000000000000u, 1220703125000000000u, 1525878906250000000u,
+	1907348632812500000u, 1192092895507812500u, 1490116119384765625u, 1862645149230957031u,
+	1164153218269348144u, 1455191522836685180u, 1818989403545856475u, 2273736754432320594u,
+	1421085471520200371u, 1776356839400250464u, 2220446049250313080u, 1387778780781445675u,
+	1734723475976807094u, 2168404344971008868u, 1355252715606880542u, 1694065894508600678u,
+	2117582368135750847u, 1323488980084844279u, 1654361225106055349u, 2067951531382569187u,
+	1292469707114105741u, 1615587133892632177u, 2019483917365790221u
+};
+
+static inline int32_t pow5bits(int32_t e)
+{
+	return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+static inline uint32_t log10_pow2(int32_t e)
+{
+	return ((uint32_t)e * 78913) >> 18;
+}
+
+static inline uint32_t log10_pow5(int32_t e)
+{
+	return ((uint32_t)e * 732923) >> 20;
+}
+
+static inline bool multiple_of_pow5(uint32_t val, uint32_t p)
+{
+	uint32_t count = 0;
+	while (val % 5 == 0) {
+		val /= 5;
+		count++;
+	}
+	return count >= p;
+}
+
+static inline bool multiple_of_pow2(uint32_t val, uint32_t p)
+{
+	return (val & ((1u << p) - 1)) == 0;
+}
+
+static inline uint32_t mul_shift(uint32_t m, uint64_t factor, int32_t shift)
+{
+	uint64_t bits0 = (uint64_t)m * (uint32_t)factor;
+	uint64_t bits1 = (uint64_t)m * (uint32_t)(factor >> 32);
+	uint64_t sum = (bits0 >> 32) + bits1;
+	return (uint32_t)(sum >> (shift - 32));
+}
+
+/* Gives the shortest decimal as *digits * 10^return value */
+static int32_t json_gen_float_shortest(uint32_t ieee_mantissa, uint32_t ieee_exponent, uint32_t *digits)
+{
+	int32_t e2;
+	uint32_t m2;
+	if (ieee_exponent == 0) {
+		e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+		m2 = ieee_mantissa;
+	} else {
+		e2 = (int32_t)ieee_exponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+		m2 = (1u << FLOAT_MANTISSA_BITS) | ieee_mantissa;
+	}
+	bool accept_bounds = (m2 & 1) == 0;
+
+	/* The interval of decimals which round to this float */
+	uint32_t mv = 4 * m2;
+	uint32_t mp = 4 * m2 + 2;
+	uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+	uint32_t mm = 4 * m2 - 1 - mm_shift;
+
+	uint32_t vr, vp, vm;
+	int32_t e10;
+	bool vm_trailing_zeros = false;
+	bool vr_trailing_zeros = false;
+	uint8_t last_removed = 0;
+	if (e2 >= 0) {
+		uint32_t q = log10_pow2(e2);
+		e10 = (int32_t)q;
+		int32_t k = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32_t)q) - 1;
+		int32_t i = -e2 + (int32_t)q + k;
+		vr = mul_shift(mv, FLOAT_POW5_INV_SPLIT[q], i);
+		vp = mul_shift(mp, FLOAT_POW5_INV_SPLIT[q], i);
+		vm = mul_shift(mm, FLOAT_POW5_INV_SPLIT[q], i);
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			int32_t l = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32_t)(q - 1)) - 1;
+			last_removed = (uint8_t)(mul_shift(mv, FLOAT_POW5_INV_SPLIT[q - 1], -e2 + (int32_t)q - 1 + l) % 10);
+		}
+		if (q <= 9) {
+			if (mv % 5 == 0)
+				vr_trailing_zeros = multiple_of_pow5(mv, q);
+			else if (accept_bounds)
+				vm_trailing_zeros = multiple_of_pow5(mm, q);
+			else
+				vp -= multiple_of_pow5(mp, q);
+		}
+	} else {
+		uint32_t q = log10_pow5(-e2);
+		e10 = (int32_t)q + e2;
+		int32_t i = -e2 - (int32_t)q;
+		int32_t k = pow5bits(i) - FLOAT_POW5_BITCOUNT;
+		int32_t j = (int32_t)q - k;
+		vr = mul_shift(mv, FLOAT_POW5_SPLIT[i], j);
+		vp = mul_shift(mp, FLOAT_POW5_SPLIT[i], j);
+		vm = mul_shift(mm, FLOAT_POW5_SPLIT[i], j);
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			j = (int32_t)q - 1 - (pow5bits(i + 1) - FLOAT_POW5_BITCOUNT);
+			last_removed = (uint8_t)(mul_shift(mv, FLOAT_POW5_SPLIT[i + 1], j) % 10);
+		}
+		if (q <= 1) {
+			vr_trailing_zeros = true;
+			if (accept_bounds)
+				vm_trailing_zeros = mm_shift == 1;
+			else
+				vp--;
+		} else if (q < 31) {
+			vr_trailing_zeros = multiple_of_pow2(mv, q - 1);
+		}
+	}
+
+	/* Drop digits for as long as the result stays within the interval */
+	int32_t removed = 0;
+	if (vm_trailing_zeros || vr_trailing_zeros) {
+		while (vp / 10 > vm / 10) {
+			vm_trailing_zeros &= vm % 10 == 0;
+			vr_trailing_zeros &= last_removed == 0;
+			last_removed = (uint8_t)(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+		if (vm_trailing_zeros) {
+			while (vm % 10 == 0) {
+				vr_trailing_zeros &= last_removed == 0;
+				last_removed = (uint8_t)(vr % 10);
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				removed++;
+			}
+		}
+		if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+			last_removed = 4;
+		*digits = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+	} else {
+		while (vp / 10 > vm / 10) {
+			last_removed = (uint8_t)(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+		*digits = vr + (vr == vm || last_removed >= 5);
+	}
+	return e10 + removed;
+}
+
+/* Plain notation where the decimal point falls within 21 digits of the number,
+ * as in JavaScript, else exponential, e.g. 0.001, 1500, 1.5e-7, 3.4028235e38
+ */
+static int json_gen_float_to_shortest(char *str, bool neg, uint32_t ieee_mantissa, uint32_t ieee_exponent)
+{
+	char *p = str;
+	if (neg)
+		*p++ = '-';
+	if (ieee_mantissa == 0 && ieee_exponent == 0) {
+		*p++ = '0';
+		return p - str;
+	}
+	uint32_t output;
+	int32_t exp = json_gen_float_shortest(ieee_mantissa, ieee_exponent, &output);
+	char digits[MAX_INT_IN_STR];
+	char *end = digits + sizeof(digits);
+	char *start = json_gen_u32_to_str(output, end);
+	int32_t len = end - start;
+	int32_t point = len + exp;
+	if (point >= len && point <= 21) {
+		memcpy(p, start, len);
+		p += len;
+		memset(p, '0', point - len);
+		p += point - len;
+	} else if (point > 0 && point <= 21) {
+		memcpy(p, start, point);
+		p += point;
+		*p++ = '.';
+		memcpy(p, start + point, len - point);
+		p += len - point;
+	} else if (point > -6 && point <= 0) {
+		*p++ = '0';
+		*p++ = '.';
+		memset(p, '0', -point);
+		p += -point;
+		memcpy(p, start, len);
+		p += len;
+	} else {
+		*p++ = *start;
+		if (len > 1) {
+			*p++ = '.';
+			memcpy(p, start + 1, len - 1);
+			p += len - 1;
+		}
+		*p++ = 'e';
+		int32_t e = point - 1;
+		if (e < 0) {
+			*p++ = '-';
+			e = -e;
+		}
+		char exp_str[4];
+		char *exp_end = exp_str + sizeof(exp_str);
+		char *exp_start = json_gen_u32_to_str(e, exp_end);
+		memcpy(p, exp_start, exp_end - exp_start);
+		p += exp_end - exp_start;
+	}
+	return p - str;
+}
+
+/* Writes val to str (of MAX_FLOAT_IN_STR bytes) and returns the length */
+static int json_gen_format_float(char *str, float val, int precision)
+{
+	uint32_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	bool neg = bits >> 31;
+	uint32_t ieee_exponent = (bits >> FLOAT_MANTISSA_BITS) & 0xff;
+	uint32_t ieee_mantissa = bits & ((1u << FLOAT_MANTISSA_BITS) - 1);
+	/* NaN and infinity cannot be represented in JSON */
+	if (ieee_exponent == 0xff) {
+		memcpy(str, "null", 4);
+		return 4;
+	}
+	if (precision < 0)
+		return json_gen_float_to_shortest(str, neg, ieee_mantissa, ieee_exponent);
+	uint32_t m = ieee_exponent ? ieee_mantissa | (1u << FLOAT_MANTISSA_BITS) : ieee_mantissa;
+	int e = (ieee_exponent ? (int)ieee_exponent : 1) - FLOAT_BIAS - FLOAT_MANTISSA_BITS;
+	if (precision > JSON_FLOAT_MAX_PRECISION)
+		precision = JSON_FLOAT_MAX_PRECISION;
+	return json_gen_float_to_fixed(str, neg, m, e, precision);
+}
+
+static int json_gen_set_float_prec(json_gen_str_t *jstr, float val, int precision)
 {
 	jstr->comma_req = true;
 	char str[MAX_FLOAT_IN_STR];
-	snprintf(str, MAX_FLOAT_IN_STR, "%.*f", JSON_FLOAT_PRECISION, val);
-	return json_gen_add_to_str(jstr, str);
+	int len = json_gen_format_float(str, val, precision);
+	return json_gen_add_to_str_n(jstr, str, len);
 }
-int json_gen_obj_set_float(json_gen_str_t *jstr, char *name, float val)
+
+static int json_gen_set_float(json_gen_str_t *jstr, float val)
 {
-	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
+	return json_gen_set_float_prec(jstr, val, JSON_FLOAT_PRECISION);
+}
+
+int json_gen_obj_set_float_n(json_gen_str_t *jstr, const char *name, int name_len, float val)
+{
+	json_gen_handle_name(jstr, name, name_len);
 	return json_gen_set_float(jstr, val);
 }
+
+int json_gen_obj_set_float(json_gen_str_t *jstr, char *name, float val)
+{
+	return json_gen_obj_set_float_n(jstr, name, strlen(name), val);
+}
+
 int json_gen_arr_set_float(json_gen_str_t *jstr, float val)
 {
 	json_gen_handle_comma(jstr);
 	return json_gen_set_float(jstr, val);
 }
 
-static int json_gen_set_string(json_gen_str_t *jstr, char *val)
+int json_gen_obj_set_float_prec(json_gen_str_t *jstr, char *name, float val, int precision)
+{
+	json_gen_handle_name(jstr, name, strlen(name));
+	return json_gen_set_float_prec(jstr, val, precision);
+}
+
+int json_gen_arr_set_float_prec(json_gen_str_t *jstr, float val, int precision)
+{
+	json_gen_handle_comma(jstr);
+	return json_gen_set_float_prec(jstr, val, precision);
+}
+
+enum {
+	JSON_GEN_NUM_INT,
+	JSON_GEN_NUM_INT64,
+	JSON_GEN_NUM_FLOAT,
+};
+
+static inline int json_gen_format_num(char *str, int type, const void *vals, int i, int precision)
+{
+	switch (type) {
+	case JSON_GEN_NUM_INT:
+		return json_gen_format_int(str, ((const int *)vals)[i]);
+	case JSON_GEN_NUM_INT64:
+		return json_gen_format_int64(str, ((const int64_t *)vals)[i]);
+	default:
+		return json_gen_format_float(str, ((const float *)vals)[i], precision);
+	}
+}
+
+/* Adds numbers as elements of the current array. As long as the buffer has room for
+ * the longest number, each one is formatted in place along with its comma, instead
+ * of being formatted separately and then copied.
+ */
+static int json_gen_add_num_array(json_gen_str_t *jstr, int type, const void *vals, int count,
+		int precision)
+{
+	int ret = 0;
+	for (int i = 0; i < count && ret == 0; i++) {
+		if (jstr->buf && !jstr->iov && json_gen_get_empty_len(jstr) > MAX_FLOAT_IN_STR) {
+			char *p = jstr->free_ptr;
+			if (jstr->comma_req)
+				*p++ = ',';
+			p += json_gen_format_num(p, type, vals, i, precision);
+			jstr->total_len += p - jstr->free_ptr;
+			jstr->free_ptr = p;
+		} else {
+			char str[MAX_FLOAT_IN_STR + 1];
+			int len = 0;
+			if (jstr->comma_req)
+				str[len++] = ',';
+			len += json_gen_format_num(str + len, type, vals, i, precision);
+			ret = json_gen_add_to_str_n(jstr, str, len);
+		}
+		jstr->comma_req = true;
+	}
+	return ret;
+}
+
+static int json_gen_obj_set_num_array(json_gen_str_t *jstr, char *name, int type, const void *vals,
+		int count, int precision)
+{
+	int ret = json_gen_push_array_n(jstr, name, strlen(name));
+	ret |= json_gen_add_num_array(jstr, type, vals, count, precision);
+	return ret | json_gen_pop_array(jstr);
+}
+
+int json_gen_obj_set_int_array(json_gen_str_t *jstr, char *name, const int *vals, int count)
+{
+	return json_gen_obj_set_num_array(jstr, name, JSON_GEN_NUM_INT, vals, count, 0);
+}
+
+int json_gen_obj_set_int64_array(json_gen_str_t *jstr, char *name, const int64_t *vals, int count)
+{
+	return json_gen_obj_set_num_array(jstr, name, JSON_GEN_NUM_INT64, vals, count, 0);
+}
+
+int json_gen_obj_set_float_array(json_gen_str_t *jstr, char *name, const float *vals, int count,
+		int precision)
+{
+	return json_gen_obj_set_num_array(jstr, name, JSON_GEN_NUM_FLOAT, vals, count, precision);
+}
+
+int json_gen_arr_set_int_array(json_gen_str_t *jstr, const int *vals, int count)
+{
+	return json_gen_add_num_array(jstr, JSON_GEN_NUM_INT, vals, count, 0);
+}
+
+int json_gen_arr_set_int64_array(json_gen_str_t *jstr, const int64_t *vals, int count)
+{
+	return json_gen_add_num_array(jstr, JSON_GEN_NUM_INT64, vals, count, 0);
+}
+
+int json_gen_arr_set_float_array(json_gen_str_t *jstr, const float *vals, int count, int precision)
+{
+	return json_gen_add_num_array(jstr, JSON_GEN_NUM_FLOAT, vals, count, precision);
+}
+
+static int json_gen_set_string(json_gen_str_t *jstr, const char *val, int len)
 {
 	jstr->comma_req = true;
-	json_gen_add_to_str(jstr, "\"");
-	json_gen_add_to_str(jstr, val);
-	return json_gen_add_to_str(jstr, "\"");
+	json_gen_add_literal(jstr, "\"");
+	if (val)
+		json_gen_add_escaped_n(jstr, val, len);
+	return json_gen_add_literal(jstr, "\"");
+}
+
+int json_gen_obj_set_string_n(json_gen_str_t *jstr, const char *name, int name_len,
+		const char *val, int val_len)
+{
+	json_gen_handle_name(jstr, name, name_len);
+	return json_gen_set_string(jstr, val, val_len);
 }
 
 int json_gen_obj_set_string(json_gen_str_t *jstr, char *name, char *val)
+{
+	return json_gen_obj_set_string_n(jstr, name, strlen(name), val, val ? strlen(val) : 0);
+}
+
+int json_gen_arr_set_string_n(json_gen_str_t *jstr, const char *val, int val_len)
 {
 	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
-	return json_gen_set_string(jstr, val);
+	return json_gen_set_string(jstr, val, val_len);
 }
 
 int json_gen_arr_set_string(json_gen_str_t *jstr, char *val)
 {
-	json_gen_handle_comma(jstr);
-	return json_gen_set_string(jstr, val);
+	return json_gen_arr_set_string_n(jstr, val, val ? strlen(val) : 0);
 }
 
 static int json_gen_set_long_string(json_gen_str_t *jstr, char *val)
 {
 	jstr->comma_req = true;
-	json_gen_add_to_str(jstr, "\"");
-	return json_gen_add_to_str(jstr, val);
+	json_gen_add_literal(jstr, "\"");
+	if (!val)
+		return 0;
+	return json_gen_add_escaped_n(jstr, val, strlen(val));
 }
 
 int json_gen_obj_start_long_string(json_gen_str_t *jstr, char *name, char *val)
 {
-	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
+	json_gen_handle_name(jstr, name, strlen(name));
     return json_gen_set_long_string(jstr, val);
 }
 
@@ -282,27 +1128,256 @@ int json_gen_arr_start_long_string(json_gen_str_t *jstr, char *val)
 
 int json_gen_add_to_long_string(json_gen_str_t *jstr, char *val)
 {
-    return json_gen_add_to_str(jstr, val);
+    if (!val) {
+        return 0;
+    }
+    return json_gen_add_escaped_n(jstr, val, strlen(val));
 }
 
 int json_gen_end_long_string(json_gen_str_t *jstr)
 {
-    return json_gen_add_to_str(jstr, "\"");
+    return json_gen_add_literal(jstr, "\"");
 }
 static int json_gen_set_null(json_gen_str_t *jstr)
 {
 	jstr->comma_req = true;
-	return json_gen_add_to_str(jstr, "null");
+	return json_gen_add_literal(jstr, "null");
 }
-int json_gen_obj_set_null(json_gen_str_t *jstr, char *name)
+
+int json_gen_obj_set_null_n(json_gen_str_t *jstr, const char *name, int name_len)
 {
-	json_gen_handle_comma(jstr);
-	json_gen_handle_name(jstr, name);
+	json_gen_handle_name(jstr, name, name_len);
 	return json_gen_set_null(jstr);
 }
 
+int json_gen_obj_set_null(json_gen_str_t *jstr, char *name)
+{
+	return json_gen_obj_set_null_n(jstr, name, strlen(name));
+}
+
 int json_gen_arr_set_null(json_gen_str_t *jstr)
 {
 	json_gen_handle_comma(jstr);
 	return json_gen_set_null(jstr);
 }
+
+static int json_gen_set_raw(json_gen_str_t *jstr, const char *val, int len)
+{
+	jstr->comma_req = true;
+	return json_gen_add_ref_n(jstr, val, len);
+}
+
+int json_gen_obj_set_raw_n(json_gen_str_t *jstr, const char *name, int name_len,
+		const char *val, int len)
+{
+	json_gen_handle_name(jstr, name, name_len);
+	return json_gen_set_raw(jstr, val, len);
+}
+
+int json_gen_obj_set_raw(json_gen_str_t *jstr, char *name, const char *val, int len)
+{
+	return json_gen_obj_set_raw_n(jstr, name, strlen(name), val, len);
+}
+
+int json_gen_arr_set_raw(json_gen_str_t *jstr, const char *val, int len)
+{
+	json_gen_handle_comma(jstr);
+	return json_gen_set_raw(jstr, val, len);
+}
+
+enum {
+	JSON_GEN_SLOT_INT,
+	JSON_GEN_SLOT_FLOAT,
+	JSON_GEN_SLOT_STRING,
+	/* A "%%", which takes no value. Its constant text ends with the first '%' */
+	JSON_GEN_SLOT_PERCENT,
+};
+
+/* Parses a conversion like %d, %8.2f, %s or %% at spec, returning its length, or 0 if
+ * it is not one (the '%' is then just part of the constant text)
+ */
+static int json_gen_template_parse_slot(const char *spec, json_gen_template_slot_t *slot)
+{
+	const char *p = spec + 1;
+	int width = 0;
+	int precision = JSON_FLOAT_PRECISION;
+	if (*p == '%') {
+		slot->type = JSON_GEN_SLOT_PERCENT;
+		slot->width = 0;
+		slot->precision = 0;
+		return 2;
+	}
+	/* Out of range numbers are only capped here, to be rejected by the caller */
+	for (; *p >= '0' && *p <= '9'; p++) {
+		if (width <= JSON_GEN_TEMPLATE_MAX_WIDTH)
+			width = width * 10 + (*p - '0');
+	}
+	if (*p == '.') {
+		precision = 0;
+		for (p++; *p >= '0' && *p <= '9'; p++) {
+			if (precision <= JSON_FLOAT_MAX_PRECISION)
+				precision = precision * 10 + (*p - '0');
+		}
+	}
+	switch (*p) {
+	case 'd':
+		slot->type = JSON_GEN_SLOT_INT;
+		break;
+	case 'f':
+		slot->type = JSON_GEN_SLOT_FLOAT;
+		break;
+	case 'g':
+		slot->type = JSON_GEN_SLOT_FLOAT;
+		precision = JSON_FLOAT_SHORTEST;
+		break;
+	case 's':
+		slot->type = JSON_GEN_SLOT_STRING;
+		break;
+	default:
+		return 0;
+	}
+	slot->width = width;
+	slot->precision = precision;
+	return p + 1 - spec;
+}
+
+int json_gen_template_compile(json_gen_template_t *tpl, const char *skeleton)
+{
+	memset(tpl, 0, sizeof(json_gen_template_t));
+	tpl->skeleton = skeleton;
+	int out_offset = 0;
+	int run = 0;
+	int i = 0;
+	while (skeleton[i]) {
+		json_gen_template_slot_t slot;
+		int len = skeleton[i] == '%' ? json_gen_template_parse_slot(skeleton + i, &slot) : 0;
+		if (!len) {
+			i++;
+			continue;
+		}
+		if (tpl->num_slots == JSON_GEN_TEMPLATE_MAX_SLOTS || slot.width > JSON_GEN_TEMPLATE_MAX_WIDTH
+				|| slot.precision > JSON_FLOAT_MAX_PRECISION
+				|| (slot.type == JSON_GEN_SLOT_STRING && slot.width))
+			return -1;
+		slot.const_offset = run;
+		slot.const_len = i - run + (slot.type == JSON_GEN_SLOT_PERCENT);
+		/* A slot can be patched in place only if everything before it has a fixed width */
+		if (out_offset >= 0)
+			out_offset += slot.const_len;
+		slot.out_offset = slot.width ? out_offset : -1;
+		if (out_offset >= 0 && slot.type != JSON_GEN_SLOT_PERCENT)
+			out_offset = slot.width ? out_offset + slot.width : -1;
+		tpl->slots[tpl->num_slots++] = slot;
+		i += len;
+		run = i;
+	}
+	tpl->tail_offset = run;
+	tpl->tail_len = i - run;
+	return 0;
+}
+
+/* Formats a numeric slot, right aligned within its width if it has one */
+static int json_gen_template_format(const json_gen_template_slot_t *slot, char *str, int ival, float fval)
+{
+	char val[MAX_FLOAT_IN_STR];
+	int len;
+	if (slot->type == JSON_GEN_SLOT_INT)
+		len = json_gen_format_int(val, ival);
+	else
+		len = json_gen_format_float(val, fval, slot->precision);
+	if (!slot->width) {
+		memcpy(str, val, len);
+		return len;
+	}
+	if (len > slot->width)
+		return -1;
+	memset(str, ' ', slot->width - len);
+	memcpy(str + slot->width - len, val, len);
+	return slot->width;
+}
+
+static int json_gen_template_vadd(json_gen_str_t *jstr, const json_gen_template_t *tpl, va_list args)
+{
+	int ret = 0;
+	for (int i = 0; i < tpl->num_slots && ret == 0; i++) {
+		const json_gen_template_slot_t *slot = &tpl->slots[i];
+		ret = json_gen_add_ref_n(jstr, tpl->skeleton + slot->const_offset, slot->const_len);
+		if (slot->type == JSON_GEN_SLOT_PERCENT) {
+			continue;
+		} else if (slot->type == JSON_GEN_SLOT_STRING) {
+			const char *val = va_arg(args, const char *);
+			/* The quotes are in the skeleton, so there is no way to write a null here */
+			ret |= val ? json_gen_add_escaped_n(jstr, val, strlen(val)) : -1;
+		} else {
+			char str[MAX_FLOAT_IN_STR];
+			int ival = 0;
+			float fval = 0;
+			if (slot->type == JSON_GEN_SLOT_INT)
+				ival = va_arg(args, int);
+			else
+				fval = (float)va_arg(args, double);
+			int len = json_gen_template_format(slot, str, ival, fval);
+			ret |= len < 0 ? -1 : json_gen_add_to_str_n(jstr, str, len);
+		}
+	}
+	if (ret == 0)
+		ret = json_gen_add_ref_n(jstr, tpl->skeleton + tpl->tail_offset, tpl->tail_len);
+	return ret;
+}
+
+int json_gen_template_render(const json_gen_template_t *tpl, char *buf, int buf_size, ...)
+{
+	json_gen_str_t jstr;
+	va_list args;
+	json_gen_str_start(&jstr, buf, buf_size, NULL, NULL);
+	va_start(args, buf_size);
+	int ret = json_gen_template_vadd(&jstr, tpl, args);
+	va_end(args);
+	int len = jstr.free_ptr - buf;
+	json_gen_str_end(&jstr);
+	return ret == 0 ? len : -1;
+}
+
+int json_gen_template_add(json_gen_str_t *jstr, const json_gen_template_t *tpl, ...)
+{
+	va_list args;
+	va_start(args, tpl);
+	int ret = json_gen_template_vadd(jstr, tpl, args);
+	va_end(args);
+	return ret;
+}
+
+static const json_gen_template_slot_t *json_gen_template_get_fixed(const json_gen_template_t *tpl,
+		int index, int type)
+{
+	/* The index counts the slots which take a value, not the %% ones */
+	for (int i = 0; i < tpl->num_slots; i++) {
+		const json_gen_template_slot_t *slot = &tpl->slots[i];
+		if (slot->type == JSON_GEN_SLOT_PERCENT || index--)
+			continue;
+		if (slot->type != type || slot->out_offset < 0)
+			return NULL;
+		return slot;
+	}
+	return NULL;
+}
+
+int json_gen_template_set_int(const json_gen_template_t *tpl, char *buf, int index, int val)
+{
+	const json_gen_template_slot_t *slot = json_gen_template_get_fixed(tpl, index, JSON_GEN_SLOT_INT);
+	char str[MAX_FLOAT_IN_STR];
+	if (!slot || json_gen_template_format(slot, str, val, 0) < 0)
+		return -1;
+	memcpy(buf + slot->out_offset, str, slot->width);
+	return 0;
+}
+
+int json_gen_template_set_float(const json_gen_template_t *tpl, char *buf, int index, float val)
+{
+	const json_gen_template_slot_t *slot = json_gen_template_get_fixed(tpl, index, JSON_GEN_SLOT_FLOAT);
+	char str[MAX_FLOAT_IN_STR];
+	if (!slot || json_gen_template_format(slot, str, 0, val) < 0)
+		return -1;
+	memcpy(buf + slot->out_offset, str, slot->width);
+	return 0;
+}
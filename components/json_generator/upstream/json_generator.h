@@ -33,11 +33,28 @@ extern "C"
 {
 #endif
 
-/** Float precision i.e. number of digits after decimal point */
+/** Precision for the shortest representation which reads back as the same float */
+#define JSON_FLOAT_SHORTEST -1
+
+/** Highest supported float precision */
+#define JSON_FLOAT_MAX_PRECISION 9
+
+/** Float precision i.e. number of digits after decimal point.
+ * Can be defined as JSON_FLOAT_SHORTEST, e.g. 54.1643 instead of 54.16430
+ */
 #ifndef JSON_FLOAT_PRECISION
 #define JSON_FLOAT_PRECISION 5
 #endif
 
+/** Name and length of a string literal, for the *_n() APIs
+ *
+ * The *_n() variants take names (and string values) along with their lengths. These need
+ * not be NULL terminated, and no strlen() is needed, unlike the plain APIs. Eg.
+ * json_gen_obj_set_int_n(jstr, JSON_GEN_KEY("first_int"), 30);
+ * where the length of the literal is worked out at compile time.
+ */
+#define JSON_GEN_KEY(name) (name), (int)(sizeof(name) - 1)
+
 /** JSON string flush callback prototype
  *
  * This is a prototype of the function that needs to be passed to
@@ -50,6 +67,57 @@ extern "C"
  */
 typedef void (*json_gen_flush_cb_t) (char *buf, void *priv);
 
+/** Nesting depth up to which json_gen_rollback() can close the open objects and arrays */
+#define JSON_GEN_MAX_NESTING 32
+
+/** Asynchronous flush callback prototype
+ *
+ * Passed to json_gen_str_start_async(). Hands a filled half of the buffer over to
+ * be sent out, typically by queueing it to a sender task, and returns without
+ * waiting for that. The generator keeps filling the other half meanwhile and does
+ * not touch this one until the \ref json_gen_flush_wait_cb_t returns.
+ *
+ * \param[in] buf Pointer to a NULL terminated JSON string
+ * \param[in] len Length of the string
+ * \param[in] priv Private data passed to json_gen_str_start_async()
+ */
+typedef void (*json_gen_async_flush_cb_t) (char *buf, int len, void *priv);
+
+/** Flush completion wait callback prototype
+ *
+ * Blocks until the buffer handed to the last \ref json_gen_async_flush_cb_t call
+ * has been sent out, e.g. by taking a semaphore which the sender task gives.
+ *
+ * \param[in] priv Private data passed to json_gen_str_start_async()
+ */
+typedef void (*json_gen_flush_wait_cb_t) (void *priv);
+
+/** Fragments at least this long are referenced instead of copied in scatter-gather mode */
+#ifndef JSON_GEN_IOV_MIN_REF
+#define JSON_GEN_IOV_MIN_REF 16
+#endif
+
+/** A segment of the output in scatter-gather mode (see json_gen_str_start_iov()) */
+typedef struct {
+    /** Start of the segment. Not NULL terminated */
+    const char *base;
+    /** Length of the segment */
+    int len;
+} json_gen_iov_t;
+
+/** Segment list flush callback prototype
+ *
+ * Invoked by the JSON generator module in scatter-gather mode either when the
+ * segment array or the scratch area is full or when json_gen_str_end() is invoked.
+ * The segments must have been sent out (or copied) by the time it returns, since
+ * the scratch area gets reused.
+ *
+ * \param[in] iov Array of segments, to be sent out in order
+ * \param[in] iov_cnt Number of segments
+ * \param[in] priv Private data passed to json_gen_str_start_iov()
+ */
+typedef void (*json_gen_iov_flush_cb_t) (const json_gen_iov_t *iov, int iov_cnt, void *priv);
+
 /** JSON String structure
  *
  * Please do not set/modify any elements.
@@ -70,6 +138,36 @@ typedef struct {
 	char *free_ptr;
     /** Total length */
     int total_len;
+    /** (For Internal use only) Segments in scatter-gather mode, NULL otherwise */
+    json_gen_iov_t *iov;
+    /** (For Internal use only) */
+    int iov_max;
+    /** (For Internal use only) */
+    int iov_cnt;
+    /** (For Internal use only) */
+    json_gen_iov_flush_cb_t iov_flush_cb;
+    /** (For Internal use only) */
+    json_gen_async_flush_cb_t async_flush_cb;
+    /** (For Internal use only) */
+    json_gen_flush_wait_cb_t wait_cb;
+    /** (For Internal use only) Half of the buffer being flushed in asynchronous mode */
+    char *alt_buf;
+    /** (For Internal use only) */
+    bool flush_pending;
+    /** (For Internal use only) One bit per open container, set for arrays */
+    uint32_t nest_types;
+    /** (For Internal use only) */
+    int depth;
+    /** (For Internal use only) Set when data did not fit in the buffer */
+    bool overflow;
+    /** (For Internal use only) Offset of the mark, -1 if none */
+    int mark_offset;
+    /** (For Internal use only) */
+    bool mark_comma_req;
+    /** (For Internal use only) */
+    uint32_t mark_nest_types;
+    /** (For Internal use only) */
+    int mark_depth;
 } json_gen_str_t;
 
 /** Start a JSON String
@@ -93,6 +191,105 @@ typedef struct {
 void json_gen_str_start(json_gen_str_t *jstr, char *buf, int buf_size,
 		json_gen_flush_cb_t flush_cb, void *priv);
 
+/** Mark the end of a complete element
+ *
+ * Remembers the current position, so that a later json_gen_rollback() can truncate the
+ * JSON string back to it. Used for packing as many elements as fit in the buffer, with
+ * a mark after each one:
+ *
+ *     json_gen_start_object(&jstr);
+ *     json_gen_push_array(&jstr, "samples");
+ *     json_gen_mark(&jstr);
+ *     for (i = 0; i < num_samples; i++) {
+ *         json_gen_arr_set_float(&jstr, samples[i]);
+ *         if (json_gen_mark(&jstr) != 0) {
+ *             json_gen_rollback(&jstr);
+ *             break;
+ *         }
+ *     }
+ *
+ * Only for JSON strings started with json_gen_str_start() with no flush callback.
+ * Should not be called in the middle of a long string.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ *
+ * \return 0 on Success
+ * \return -1 if some data since the last mark did not fit, there would not be enough
+ * space left to close the open objects and arrays after this point, or more than
+ * JSON_GEN_MAX_NESTING levels are open. The previous mark is kept then.
+ */
+int json_gen_mark(json_gen_str_t *jstr);
+
+/** Roll back to the last mark
+ *
+ * Truncates the JSON string to the position of the last json_gen_mark() and closes all
+ * the objects and arrays open there, giving a complete JSON string. Nothing more should
+ * be added after this, other than calling json_gen_str_end().
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ *
+ * \return 0 on Success
+ * \return -1 if there is no mark
+ */
+int json_gen_rollback(json_gen_str_t *jstr);
+
+/** Start a JSON String in double buffered asynchronous mode
+ *
+ * Same as json_gen_str_start(), but the buffer is split into two halves. When one
+ * is full, it is handed to flush_cb and the generator carries on in the other
+ * half, so that serializing overlaps with sending instead of waiting for it. It
+ * only waits (with wait_cb) when the other half is still being sent out.
+ * json_gen_str_end() flushes the last part and waits for all of it to be sent.
+ *
+ * \param[out] jstr Pointer to an allocated \ref json_gen_str_t structure
+ * \param[out] buf Pointer to an allocated buffer, to be used as two halves
+ * \param[in] buf_size Size of the buffer. At least 4
+ * \param[in] flush_cb Pointer to the asynchronous flushing function of type
+ * \ref json_gen_async_flush_cb_t
+ * \param[in] wait_cb Pointer to the function of type \ref json_gen_flush_wait_cb_t
+ * waiting for the last flush to complete
+ * \param[in] priv Private data to be passed to both the callbacks
+ */
+void json_gen_str_start_async(json_gen_str_t *jstr, char *buf, int buf_size,
+		json_gen_async_flush_cb_t flush_cb, json_gen_flush_wait_cb_t wait_cb, void *priv);
+
+/** Start a JSON String in scatter-gather mode
+ *
+ * Same as json_gen_str_start(), but instead of one contiguous string the output is
+ * a list of segments, to be handed to a vectored send. Names, raw values, object and
+ * array strings and template text of at least JSON_GEN_IOV_MIN_REF bytes are referenced
+ * where they are, without being copied, so they must stay valid until the segments have
+ * been flushed out. Everything else (numbers, string values, punctuation and shorter
+ * fragments) gets written to the scratch area. Adjacent segments are merged.
+ *
+ * \param[out] jstr Pointer to an allocated \ref json_gen_str_t structure
+ * \param[out] iov Array for the segments
+ * \param[in] max_iov Number of elements in the above array
+ * \param[out] scratch Buffer for the data which is not referenced
+ * \param[in] scratch_size Size of the scratch buffer
+ * \param[in] flush_cb Pointer to the flushing function of type \ref json_gen_iov_flush_cb_t
+ * which will be invoked either when iov or scratch is full or when json_gen_str_end()
+ * is invoked. Can be left NULL, in which case the APIs fail when either is full and the
+ * segments are left in iov (see json_gen_get_iov_count()).
+ * \param[in] priv Private data to be passed to the flushing function callback.
+ */
+void json_gen_str_start_iov(json_gen_str_t *jstr, json_gen_iov_t *iov, int max_iov,
+		char *scratch, int scratch_size, json_gen_iov_flush_cb_t flush_cb, void *priv);
+
+/** Get the number of segments collected so far in scatter-gather mode
+ *
+ * To be called before json_gen_str_end(), when no flush callback was given
+ * to json_gen_str_start_iov().
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start_iov()
+ *
+ * \return Number of segments in the iov array
+ */
+int json_gen_get_iov_count(json_gen_str_t *jstr);
+
 /** End JSON string
  *
  * This should be the last function to be called after the entire JSON string
@@ -176,6 +373,22 @@ int json_gen_end_array(json_gen_str_t *jstr);
  */
 int json_gen_push_object(json_gen_str_t *jstr, char *name);
 
+/** Push a named JSON object, with the name length given
+ *
+ * Same as json_gen_push_object(), with the length of the name given.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] name_len Length of the name
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_push_object_n(json_gen_str_t *jstr, const char *name, int name_len);
+
 /** Pop a named JSON object
  *
  * This ends a JSON object by adding a '}'. This is basically same as
@@ -225,6 +438,22 @@ int json_gen_push_object_str(json_gen_str_t *jstr, char *name, char *object_str)
  */
 int json_gen_push_array(json_gen_str_t *jstr, char *name);
 
+/** Push a named JSON array, with the name length given
+ *
+ * Same as json_gen_push_array(), with the length of the name given.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] name_len Length of the name
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_push_array_n(json_gen_str_t *jstr, const char *name, int name_len);
+
 /** Pop a named JSON array
  *
  * This ends a JSON array by adding a ']'. This is basically same as
@@ -278,6 +507,23 @@ int json_gen_push_array_str(json_gen_str_t *jstr, char *name, char *array_str);
  */
 int json_gen_obj_set_bool(json_gen_str_t *jstr, char *name, bool val);
 
+/** Add a boolean element to an object, with the name length given
+ *
+ * Same as json_gen_obj_set_bool(), with the length of the name given.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] name_len Length of the name
+ * \param[in] val Boolean value of the element
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_bool_n(json_gen_str_t *jstr, const char *name, int name_len, bool val);
+
 /** Add an integer element to an object
  *
  * This adds an integer element to an object. Eg. "int_val":28
@@ -297,9 +543,39 @@ int json_gen_obj_set_bool(json_gen_str_t *jstr, char *name, bool val);
  */
 int json_gen_obj_set_int(json_gen_str_t *jstr, char *name, int val);
 
+/** Add an integer element to an object, with the name length given
+ *
+ * Same as json_gen_obj_set_int(), with the length of the name given.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] name_len Length of the name
+ * \param[in] val Integer value of the element
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_int_n(json_gen_str_t *jstr, const char *name, int name_len, int val);
+
+/** Add a 64 bit integer element to an object
+ *
+ * Same as json_gen_obj_set_int(), for int64_t values.
+ */
+int json_gen_obj_set_int64(json_gen_str_t *jstr, char *name, int64_t val);
+
+/** Add a 64 bit integer element to an object, with the name length given
+ *
+ * Same as json_gen_obj_set_int_n(), for int64_t values.
+ */
+int json_gen_obj_set_int64_n(json_gen_str_t *jstr, const char *name, int name_len, int64_t val);
+
 /** Add a float element to an object
  *
  * This adds a float element to an object. Eg. "float_val":23.8
+ * NaN and infinity cannot be represented in JSON and are added as null.
  *
  * \note This must be called between json_gen_start_object()/json_gen_push_object()
  * and json_gen_end_object()/json_gen_pop_object()
@@ -316,9 +592,48 @@ int json_gen_obj_set_int(json_gen_str_t *jstr, char *name, int val);
  */
 int json_gen_obj_set_float(json_gen_str_t *jstr, char *name, float val);
 
+/** Add a float element to an object, with the name length given
+ *
+ * Same as json_gen_obj_set_float(), with the length of the name given.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] name_len Length of the name
+ * \param[in] val Float value of the element
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_float_n(json_gen_str_t *jstr, const char *name, int name_len, float val);
+
+/** Add a float element to an object, with the precision given
+ *
+ * Same as json_gen_obj_set_float(), but with the given number of digits after the decimal
+ * point instead of JSON_FLOAT_PRECISION. With JSON_FLOAT_SHORTEST, the float is written with
+ * just as many digits as needed to read back the same value, Eg. "rate":0.1 and "big":1.5e20
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] val Float value of the element
+ * \param[in] precision Digits after the decimal point (up to JSON_FLOAT_MAX_PRECISION)
+ * or JSON_FLOAT_SHORTEST
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_float_prec(json_gen_str_t *jstr, char *name, float val, int precision);
+
 /** Add a string element to an object
  *
  * This adds a string element to an object. Eg. "string_val":"my_string"
+ * Quotes, backslashes and control characters in the value get escaped, Eg. a new line
+ * is added as \n. Names are added as they are.
  *
  * \note This must be called between json_gen_start_object()/json_gen_push_object()
  * and json_gen_end_object()/json_gen_pop_object()
@@ -335,6 +650,26 @@ int json_gen_obj_set_float(json_gen_str_t *jstr, char *name, float val);
  */
 int json_gen_obj_set_string(json_gen_str_t *jstr, char *name, char *val);
 
+/** Add a string element to an object, with the lengths given
+ *
+ * Same as json_gen_obj_set_string(), with the lengths of the name and
+ * value given.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] name_len Length of the name
+ * \param[in] val String value of the element
+ * \param[in] val_len Length of the value
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_string_n(json_gen_str_t *jstr, const char *name, int name_len,
+		const char *val, int val_len);
+
 /** Add a NULL element to an object
  *
  * This adds a NULL element to an object. Eg. "null_val":null
@@ -353,6 +688,22 @@ int json_gen_obj_set_string(json_gen_str_t *jstr, char *name, char *val);
  */
 int json_gen_obj_set_null(json_gen_str_t *jstr, char *name);
 
+/** Add a NULL element to an object, with the name length given
+ *
+ * Same as json_gen_obj_set_null(), with the length of the name given.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] name_len Length of the name
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_null_n(json_gen_str_t *jstr, const char *name, int name_len);
+
 /** Add a boolean element to an array
  *
  * \note This must be called between json_gen_start_array()/json_gen_push_array()
@@ -385,6 +736,12 @@ int json_gen_arr_set_bool(json_gen_str_t *jstr, bool val);
  */
 int json_gen_arr_set_int(json_gen_str_t *jstr, int val);
 
+/** Add a 64 bit integer element to an array
+ *
+ * Same as json_gen_arr_set_int(), for int64_t values.
+ */
+int json_gen_arr_set_int64(json_gen_str_t *jstr, int64_t val);
+
 /** Add a float element to an array
  *
  * \note This must be called between json_gen_start_array()/json_gen_push_array()
@@ -401,6 +758,109 @@ int json_gen_arr_set_int(json_gen_str_t *jstr, int val);
  */
 int json_gen_arr_set_float(json_gen_str_t *jstr, float val);
 
+/** Add a float element to an array, with the precision given
+ *
+ * Same as json_gen_arr_set_float(), but with the given precision, as for
+ * json_gen_obj_set_float_prec()
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] val Float value of the element
+ * \param[in] precision Digits after the decimal point (up to JSON_FLOAT_MAX_PRECISION)
+ * or JSON_FLOAT_SHORTEST
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_arr_set_float_prec(json_gen_str_t *jstr, float val, int precision);
+
+/** Add an array of integers to an object
+ *
+ * Adds "name":[vals[0],vals[1],...] in one go, formatting the numbers straight into
+ * the buffer whenever there is room.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] vals The integers
+ * \param[in] count Number of integers
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_int_array(json_gen_str_t *jstr, char *name, const int *vals, int count);
+
+/** Add an array of 64 bit integers to an object
+ *
+ * Same as json_gen_obj_set_int_array(), for int64_t values.
+ */
+int json_gen_obj_set_int64_array(json_gen_str_t *jstr, char *name, const int64_t *vals, int count);
+
+/** Add an array of floats to an object
+ *
+ * Same as json_gen_obj_set_int_array(), for floats, all with the same precision.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] vals The floats
+ * \param[in] count Number of floats
+ * \param[in] precision Digits after the decimal point (up to JSON_FLOAT_MAX_PRECISION)
+ * or JSON_FLOAT_SHORTEST
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_float_array(json_gen_str_t *jstr, char *name, const float *vals, int count,
+		int precision);
+
+/** Add integers to an array
+ *
+ * Adds each of the integers as an element of the array currently open, like calling
+ * json_gen_arr_set_int() for each of them, but in one tight loop.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] vals The integers
+ * \param[in] count Number of integers
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_arr_set_int_array(json_gen_str_t *jstr, const int *vals, int count);
+
+/** Add 64 bit integers to an array
+ *
+ * Same as json_gen_arr_set_int_array(), for int64_t values.
+ */
+int json_gen_arr_set_int64_array(json_gen_str_t *jstr, const int64_t *vals, int count);
+
+/** Add floats to an array
+ *
+ * Same as json_gen_arr_set_int_array(), for floats, all with the same precision.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] vals The floats
+ * \param[in] count Number of floats
+ * \param[in] precision Digits after the decimal point (up to JSON_FLOAT_MAX_PRECISION)
+ * or JSON_FLOAT_SHORTEST
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_arr_set_float_array(json_gen_str_t *jstr, const float *vals, int count, int precision);
+
 /** Add a string element to an array
  *
  * \note This must be called between json_gen_start_array()/json_gen_push_array()
@@ -417,6 +877,22 @@ int json_gen_arr_set_float(json_gen_str_t *jstr, float val);
  */
 int json_gen_arr_set_string(json_gen_str_t *jstr, char *val);
 
+/** Add a string element to an array, with the length given
+ *
+ * Same as json_gen_arr_set_string(), but the value need not be NULL terminated.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] val String value of the element
+ * \param[in] val_len Length of the value
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_arr_set_string_n(json_gen_str_t *jstr, const char *val, int val_len);
+
 /** Add a NULL element to an array
  *
  * \note This must be called between json_gen_start_array()/json_gen_push_array()
@@ -505,6 +981,184 @@ int json_gen_add_to_long_string(json_gen_str_t *jstr, char *val);
  * added after that
  */
 int json_gen_end_long_string(json_gen_str_t *jstr);
+
+/** Add a raw JSON value to an object
+ *
+ * This adds an element whose value is already encoded JSON text of a known length,
+ * copied as is. Eg. json_gen_obj_set_raw(jstr, "val", "[1,2]", 5) adds "val":[1,2].
+ * Unlike json_gen_push_object_str(), the value need not be NULL terminated, so that
+ * it can point straight into a buffer parsed by json_parser.
+ *
+ * \note This must be called between json_gen_start_object()/json_gen_push_object()
+ * and json_gen_end_object()/json_gen_pop_object()
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] val Encoded JSON value
+ * \param[in] len Length of val
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_raw(json_gen_str_t *jstr, char *name, const char *val, int len);
+
+/** Add a raw JSON value to an object, with the name length given
+ *
+ * Same as json_gen_obj_set_raw(), with the length of the name given.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] name Name of the element
+ * \param[in] name_len Length of the name
+ * \param[in] val Encoded JSON value
+ * \param[in] len Length of val
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_obj_set_raw_n(json_gen_str_t *jstr, const char *name, int name_len,
+		const char *val, int len);
+
+/** Add a raw JSON value to an array
+ *
+ * This adds an element which is already encoded JSON text of a known length, copied as is.
+ * It can also be used outside of any object or array, to write a complete document.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start()
+ * \param[in] val Encoded JSON value
+ * \param[in] len Length of val
+ *
+ * \return 0 on Success
+ * \return -1 if buffer is out of space (possible only if no callback function
+ * is passed to json_gen_str_start(). Else, buffer will be flushed out and new data
+ * added after that
+ */
+int json_gen_arr_set_raw(json_gen_str_t *jstr, const char *val, int len);
+
+/** Maximum number of value slots in a template */
+#define JSON_GEN_TEMPLATE_MAX_SLOTS 8
+
+/** Maximum width of a fixed width template slot */
+#define JSON_GEN_TEMPLATE_MAX_WIDTH 32
+
+/** A value slot of a template. For internal use only */
+typedef struct {
+    /** Offset and length of the constant text before the slot, in the skeleton */
+	int const_offset;
+	int const_len;
+    /** Offset of the slot in the rendered output, or -1 if it is not fixed */
+	int out_offset;
+	uint8_t type;
+	uint8_t width;
+	int8_t precision;
+} json_gen_template_slot_t;
+
+/** Compiled JSON template
+ *
+ * Please do not set/modify any elements. Initialise it with json_gen_template_compile()
+ */
+typedef struct {
+    /** The skeleton passed to json_gen_template_compile(). Not copied */
+	const char *skeleton;
+	json_gen_template_slot_t slots[JSON_GEN_TEMPLATE_MAX_SLOTS];
+	int num_slots;
+	int tail_offset;
+	int tail_len;
+} json_gen_template_t;
+
+/** Compile a JSON template
+ *
+ * For payloads which have the same structure every time, with just a few changing values.
+ * The skeleton is the payload with conversions in place of the values:
+ * - %d for an int
+ * - %f for a float with JSON_FLOAT_PRECISION digits after the decimal point,
+ *   %.Nf for N digits, %g for the shortest representation
+ * - %s for the contents of a string, which get escaped (the quotes belong in the skeleton).
+ *   It cannot be NULL
+ * - %% for a single '%', which also counts towards JSON_GEN_TEMPLATE_MAX_SLOTS
+ *
+ * Numeric conversions can have a width, like %6d or %10.2f. The value is then always written
+ * right aligned in that many characters, padded with spaces (which is valid JSON), so that
+ * it can later be overwritten in place with json_gen_template_set_int()/json_gen_template_set_float(),
+ * as long as all slots before it also have a width. A '%' which does not start a conversion
+ * is copied as is.
+ *
+ * Eg. json_gen_template_compile(&tpl, "{\"temp\":%8.2f,\"count\":%6d}");
+ *
+ * \param[out] tpl Pointer to the \ref json_gen_template_t structure to initialise
+ * \param[in] skeleton The skeleton. It must stay valid as long as the template is used
+ *
+ * \return 0 on Success
+ * \return -1 if there are more than JSON_GEN_TEMPLATE_MAX_SLOTS slots or a conversion is invalid
+ */
+int json_gen_template_compile(json_gen_template_t *tpl, const char *skeleton);
+
+/** Render a JSON template
+ *
+ * Writes the complete payload to buf, with the values for the slots passed in order,
+ * like for printf(). The constant parts are copied as they are.
+ *
+ * \param[in] tpl Pointer to the template compiled with json_gen_template_compile()
+ * \param[out] buf Buffer for the payload, which gets NULL terminated
+ * \param[in] buf_size Size of the buffer
+ *
+ * \return Length of the payload on Success
+ * \return -1 if the buffer is too small, a value is wider than its slot or a string is NULL
+ */
+int json_gen_template_render(const json_gen_template_t *tpl, char *buf, int buf_size, ...);
+
+/** Add a rendered JSON template to a JSON string
+ *
+ * Same as json_gen_template_render(), but the payload is appended as it is (with no
+ * comma handling) to a JSON string, e.g. as the whole document right after
+ * json_gen_str_start_iov(). In scatter-gather mode, the constant parts are then
+ * referenced in the skeleton instead of being copied.
+ *
+ * \param[in] jstr Pointer to the \ref json_gen_str_t structure initialised by
+ * json_gen_str_start() or json_gen_str_start_iov()
+ * \param[in] tpl Pointer to the template compiled with json_gen_template_compile()
+ *
+ * \return 0 on Success
+ * \return -1 if out of space (with no callback function), a value is wider than its slot
+ * or a string is NULL
+ */
+int json_gen_template_add(json_gen_str_t *jstr, const json_gen_template_t *tpl, ...);
+
+/** Patch an integer slot of a rendered template
+ *
+ * Overwrites the value of a fixed width %d slot in a payload rendered with
+ * json_gen_template_render(), without touching the rest of the buffer.
+ *
+ * \param[in] tpl Pointer to the template compiled with json_gen_template_compile()
+ * \param[in,out] buf The rendered payload
+ * \param[in] index Index of the slot in the skeleton, starting from 0, not counting %%
+ * \param[in] val New value
+ *
+ * \return 0 on Success
+ * \return -1 if the slot cannot be patched in place or the value does not fit in it
+ */
+int json_gen_template_set_int(const json_gen_template_t *tpl, char *buf, int index, int val);
+
+/** Patch a float slot of a rendered template
+ *
+ * Overwrites the value of a fixed width %f or %g slot in a payload rendered with
+ * json_gen_template_render(), without touching the rest of the buffer.
+ *
+ * \param[in] tpl Pointer to the template compiled with json_gen_template_compile()
+ * \param[in,out] buf The rendered payload
+ * \param[in] index Index of the slot in the skeleton, starting from 0, not counting %%
+ * \param[in] val New value
+ *
+ * \return 0 on Success
+ * \return -1 if the slot cannot be patched in place or the value does not fit in it
+ */
+int json_gen_template_set_float(const json_gen_template_t *tpl, char *buf, int index, float val);
 #ifdef __cplusplus
 }
 #endif
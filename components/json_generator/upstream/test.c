@@ -17,6 +17,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <json_generator.h>
+#include <cbor_generator.h>
 
 static const char expected_str[] = "{\"first_bool\":true,\"first_int\":30,"\
         "\"float_val\":54.16430,\"my_str\":\"new_name\",\"null_obj\":null,"\
@@ -58,34 +59,39 @@ static void flush_str(char *buf, void *priv)
 }
 */
 
+static void json_gen_build(json_gen_str_t *jstr)
+{
+	json_gen_start_object(jstr);
+	json_gen_obj_set_bool(jstr, "first_bool", true);
+	json_gen_obj_set_int(jstr, "first_int", 30);
+	json_gen_obj_set_float(jstr, "float_val", 54.1643);
+	json_gen_obj_set_string(jstr, "my_str", "new_name");
+	json_gen_obj_set_null(jstr, "null_obj");
+	json_gen_push_array(jstr, "arr");
+	json_gen_start_array(jstr);
+	json_gen_arr_set_string(jstr, "arr_string");
+	json_gen_arr_set_bool(jstr, false);
+	json_gen_arr_set_float(jstr, 45.12);
+	json_gen_arr_set_null(jstr);
+	json_gen_arr_set_int(jstr, 25);
+	json_gen_start_object(jstr);
+	json_gen_obj_set_string(jstr, "arr_obj_str", "sample");
+	json_gen_end_object(jstr);
+	json_gen_end_array(jstr);
+	json_gen_pop_array(jstr);
+	json_gen_push_object_n(jstr, JSON_GEN_KEY("my_obj"));
+	json_gen_obj_set_int_n(jstr, JSON_GEN_KEY("only_val"), 5);
+	json_gen_pop_object(jstr);
+	json_gen_end_object(jstr);
+}
+
 static int json_gen_perform_test(json_gen_test_result_t *result, const char *expected)
 {
 	char buf[20];
     memset(result, 0, sizeof(json_gen_test_result_t));
 	json_gen_str_t jstr;
 	json_gen_str_start(&jstr, buf, sizeof(buf), flush_str, result);
-	json_gen_start_object(&jstr);
-	json_gen_obj_set_bool(&jstr, "first_bool", true);
-	json_gen_obj_set_int(&jstr, "first_int", 30);
-	json_gen_obj_set_float(&jstr, "float_val", 54.1643);
-	json_gen_obj_set_string(&jstr, "my_str", "new_name");
-	json_gen_obj_set_null(&jstr, "null_obj");
-	json_gen_push_array(&jstr, "arr");
-	json_gen_start_array(&jstr);
-	json_gen_arr_set_string(&jstr, "arr_string");
-	json_gen_arr_set_bool(&jstr, false);
-	json_gen_arr_set_float(&jstr, 45.12);
-	json_gen_arr_set_null(&jstr);
-	json_gen_arr_set_int(&jstr, 25);
-	json_gen_start_object(&jstr);
-	json_gen_obj_set_string(&jstr, "arr_obj_str", "sample");
-	json_gen_end_object(&jstr);
-	json_gen_end_array(&jstr);
-	json_gen_pop_array(&jstr);
-	json_gen_push_object(&jstr, "my_obj");
-	json_gen_obj_set_int(&jstr, "only_val", 5);
-	json_gen_pop_object(&jstr);
-	json_gen_end_object(&jstr);
+	json_gen_build(&jstr);
 	json_gen_str_end(&jstr);
     if (strcmp(expected, result->buf) == 0) {
         return 0;
@@ -94,13 +100,236 @@ static int json_gen_perform_test(json_gen_test_result_t *result, const char *exp
     }
 }
 
+typedef struct {
+    json_gen_test_result_t *result;
+    char *pending;
+    int pending_len;
+} json_gen_async_test_ctx_t;
+
+/* Only takes note of the half handed over. It gets "sent" when waited for, so
+ * the generator must not have touched it in between
+ */
+static void flush_async(char *buf, int len, void *priv)
+{
+    json_gen_async_test_ctx_t *ctx = (json_gen_async_test_ctx_t *)priv;
+    ctx->pending = buf;
+    ctx->pending_len = len;
+}
+
+static void flush_wait(void *priv)
+{
+    json_gen_async_test_ctx_t *ctx = (json_gen_async_test_ctx_t *)priv;
+    json_gen_test_result_t *result = ctx->result;
+    if (ctx->pending_len > (int)(sizeof(result->buf) - result->offset - 1)) {
+        printf("Result Buffer too small\r\n");
+        return;
+    }
+    memcpy(result->buf + result->offset, ctx->pending, ctx->pending_len);
+    result->offset += ctx->pending_len;
+    ctx->pending = NULL;
+}
+
+static int json_gen_perform_async_test(json_gen_test_result_t *result, const char *expected)
+{
+	char buf[20];
+	json_gen_async_test_ctx_t ctx = { .result = result };
+    memset(result, 0, sizeof(json_gen_test_result_t));
+	json_gen_str_t jstr;
+	json_gen_str_start_async(&jstr, buf, sizeof(buf), flush_async, flush_wait, &ctx);
+	json_gen_build(&jstr);
+	json_gen_str_end(&jstr);
+	return ctx.pending == NULL && strcmp(expected, result->buf) == 0 ? 0 : -1;
+}
+
+static const char *expected_array_str = "{\"ints\":[1,-2,30000],\"int64s\":[-9223372036854775807,100000000],"\
+        "\"floats\":[0.5,-1.25,0.1]}";
+
+static int json_gen_perform_array_test(char *buf, int buf_size, const char *expected)
+{
+	const int ints[] = {1, -2, 30000};
+	const int64_t int64s[] = {-9223372036854775807LL, 100000000};
+	const float floats[] = {0.5, -1.25, 0.1};
+	json_gen_str_t jstr;
+	json_gen_str_start(&jstr, buf, buf_size, NULL, NULL);
+	json_gen_start_object(&jstr);
+	int ret = json_gen_obj_set_int_array(&jstr, "ints", ints, 3);
+	ret |= json_gen_obj_set_int64_array(&jstr, "int64s", int64s, 2);
+	ret |= json_gen_push_array(&jstr, "floats");
+	ret |= json_gen_arr_set_float_array(&jstr, floats, 3, JSON_FLOAT_SHORTEST);
+	ret |= json_gen_pop_array(&jstr);
+	ret |= json_gen_end_object(&jstr);
+	json_gen_str_end(&jstr);
+	return ret == 0 && strcmp(buf, expected) == 0 ? 0 : -1;
+}
+
+static const char *expected_packed_str = "{\"samples\":[100,101,102,103,104,105]}";
+
+/* Packs as many of 20 samples as fit in the buffer */
+static int json_gen_perform_rollback_test(char *buf, int buf_size, const char *expected)
+{
+	json_gen_str_t jstr;
+	json_gen_str_start(&jstr, buf, buf_size, NULL, NULL);
+	json_gen_start_object(&jstr);
+	json_gen_push_array(&jstr, "samples");
+	json_gen_mark(&jstr);
+	for (int i = 0; i < 20; i++) {
+		json_gen_arr_set_int(&jstr, 100 + i);
+		if (json_gen_mark(&jstr) != 0) {
+			break;
+		}
+	}
+	int ret = json_gen_rollback(&jstr);
+	json_gen_str_end(&jstr);
+	return ret == 0 && strcmp(buf, expected) == 0 ? 0 : -1;
+}
+
+static const char *expected_template_str = "[{\"values\":[{\"value\":   -3.25,\"count\":   12}],\"label\":\"Temp \\\"C\\\"\"}]";
+
+/* Renders a template and then patches both of its values in place */
+static int json_gen_perform_template_test(char *buf, int buf_size, const char *expected)
+{
+	json_gen_template_t tpl;
+	if (json_gen_template_compile(&tpl,
+			"[{\"values\":[{\"value\":%8.2f,\"count\":%5d}],\"label\":\"%s\"}]") != 0)
+		return -1;
+	if (json_gen_template_render(&tpl, buf, buf_size, 21.5, 3, "Temp \"C\"") < 0)
+		return -1;
+	if (json_gen_template_set_float(&tpl, buf, 0, -3.25) != 0 || json_gen_template_set_int(&tpl, buf, 1, 12) != 0)
+		return -1;
+	return strcmp(buf, expected) == 0 ? 0 : -1;
+}
+
+static const char *expected_percent_str = "{\"load\":\"  50%\",\"v\": 42,\"name\":\"x\"}";
+
+/* A %% is a single '%' which takes no value, so the slot after it is still index 1.
+ * A NULL string cannot be rendered.
+ */
+static int json_gen_perform_template_percent_test(char *buf, int buf_size, const char *expected)
+{
+	json_gen_template_t tpl;
+	if (json_gen_template_compile(&tpl, "{\"load\":\"%4d%%\",\"v\":%3d,\"name\":\"%s\"}") != 0)
+		return -1;
+	if (json_gen_template_render(&tpl, buf, buf_size, 50, 7, (char *)NULL) != -1)
+		return -1;
+	if (json_gen_template_render(&tpl, buf, buf_size, 50, 7, "x") < 0)
+		return -1;
+	if (json_gen_template_set_int(&tpl, buf, 1, 42) != 0)
+		return -1;
+	return strcmp(buf, expected) == 0 ? 0 : -1;
+}
+
+static const char *expected_iov_str = "[{\"values\":[{\"value\":   21.50,\"count\":    3}],\"label\":\"Temp \\\"C\\\"\"}]";
+
+static void flush_iov(const json_gen_iov_t *iov, int iov_cnt, void *priv)
+{
+    json_gen_test_result_t *result = (json_gen_test_result_t *)priv;
+    for (int i = 0; i < iov_cnt; i++) {
+        if ((size_t)iov[i].len >= sizeof(result->buf) - result->offset) {
+            printf("Result Buffer too small\r\n");
+            return;
+        }
+        memcpy(result->buf + result->offset, iov[i].base, iov[i].len);
+        result->offset += iov[i].len;
+    }
+}
+
+/* Adds a template to a segment list, with a scratch area and segment array small
+ * enough to need several flushes
+ */
+static int json_gen_perform_iov_test(json_gen_test_result_t *result, const char *expected)
+{
+	json_gen_template_t tpl;
+	json_gen_iov_t iov[3];
+	char scratch[8];
+	json_gen_str_t jstr;
+	memset(result, 0, sizeof(json_gen_test_result_t));
+	if (json_gen_template_compile(&tpl,
+			"[{\"values\":[{\"value\":%8.2f,\"count\":%5d}],\"label\":\"%s\"}]") != 0)
+		return -1;
+	json_gen_str_start_iov(&jstr, iov, 3, scratch, sizeof(scratch), flush_iov, result);
+	int ret = json_gen_template_add(&jstr, &tpl, 21.5, 3, "Temp \"C\"");
+	json_gen_str_end(&jstr);
+	return ret == 0 && strcmp(result->buf, expected) == 0 ? 0 : -1;
+}
+
+/* {"temp":23.5,"ints":[1,-2,30000],"ok":true,"val":0.1,"sub":[null]} in CBOR */
+static const uint8_t expected_cbor[] = {
+	0xbf, 0x64, 't', 'e', 'm', 'p', 0xf9, 0x4d, 0xe0,
+	0x64, 'i', 'n', 't', 's', 0x83, 0x01, 0x21, 0x19, 0x75, 0x30,
+	0x62, 'o', 'k', 0xf5,
+	0x63, 'v', 'a', 'l', 0xfa, 0x3d, 0xcc, 0xcc, 0xcd,
+	0x63, 's', 'u', 'b', 0x9f, 0xf6, 0xff,
+	0xff
+};
+
+static void flush_cbor(uint8_t *buf, int len, void *priv)
+{
+    json_gen_test_result_t *result = (json_gen_test_result_t *)priv;
+    if ((size_t)len > sizeof(result->buf) - result->offset) {
+        printf("Result Buffer too small\r\n");
+        return;
+    }
+    memcpy(result->buf + result->offset, buf, len);
+    result->offset += len;
+}
+
+/* Generates CBOR with the same calls as JSON, through a buffer small enough to
+ * need several flushes
+ */
+static int cbor_gen_perform_test(json_gen_test_result_t *result, const uint8_t *expected, int expected_len)
+{
+	const int ints[] = {1, -2, 30000};
+	uint8_t buf[8];
+	cbor_gen_str_t cstr;
+	memset(result, 0, sizeof(json_gen_test_result_t));
+	cbor_gen_str_start(&cstr, buf, sizeof(buf), flush_cbor, result);
+	int ret = cbor_gen_start_object(&cstr);
+	ret |= cbor_gen_obj_set_float(&cstr, "temp", 23.5);
+	ret |= cbor_gen_obj_set_int_array(&cstr, "ints", ints, 3);
+	ret |= cbor_gen_obj_set_bool(&cstr, "ok", true);
+	ret |= cbor_gen_obj_set_float(&cstr, "val", 0.1);
+	ret |= cbor_gen_push_array(&cstr, "sub");
+	ret |= cbor_gen_arr_set_null(&cstr);
+	ret |= cbor_gen_pop_array(&cstr);
+	ret |= cbor_gen_end_object(&cstr);
+	int len = cbor_gen_str_end(&cstr);
+	if (ret != 0 || len != expected_len || (int)result->offset != len)
+		return -1;
+	return memcmp(result->buf, expected, len) == 0 ? 0 : -1;
+}
+
 int main(int argc, char **argv)
 {
     json_gen_test_result_t result;
+    char template_buf[128];
+    char packed_buf[40];
+    char array_buf[128];
 	printf("Creating JSON string [may require Line wrap enabled on console]\r\n");
     int ret = json_gen_perform_test(&result, expected_str);
     printf("Expected: %s\r\n", expected_str);
 	printf("Generated: %s\r\n", result.buf);
+    ret |= json_gen_perform_async_test(&result, expected_str);
+	printf("Async: %s\r\n", result.buf);
+    ret |= json_gen_perform_array_test(array_buf, sizeof(array_buf), expected_array_str);
+    printf("Expected: %s\r\n", expected_array_str);
+	printf("Arrays: %s\r\n", array_buf);
+    ret |= json_gen_perform_rollback_test(packed_buf, sizeof(packed_buf), expected_packed_str);
+    printf("Expected: %s\r\n", expected_packed_str);
+	printf("Packed: %s\r\n", packed_buf);
+    ret |= json_gen_perform_template_test(template_buf, sizeof(template_buf), expected_template_str);
+    printf("Expected: %s\r\n", expected_template_str);
+	printf("Template: %s\r\n", template_buf);
+    ret |= json_gen_perform_template_percent_test(template_buf, sizeof(template_buf), expected_percent_str);
+    printf("Expected: %s\r\n", expected_percent_str);
+	printf("Percent: %s\r\n", template_buf);
+    ret |= json_gen_perform_iov_test(&result, expected_iov_str);
+    printf("Expected: %s\r\n", expected_iov_str);
+	printf("Segments: %s\r\n", result.buf);
+    ret |= cbor_gen_perform_test(&result, expected_cbor, sizeof(expected_cbor));
+	printf("CBOR: ");
+	for (size_t i = 0; i < result.offset; i++)
+		printf("%02x", (uint8_t)result.buf[i]);
+	printf(" (%d bytes)\r\n", (int)result.offset);
     if (ret == 0) {
         printf("Test Passed!\r\n");
     } else {
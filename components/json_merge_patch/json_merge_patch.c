@@ -0,0 +1,412 @@
+// Copyright 2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_merge_patch.h"
+
+/* Key tables of up to this many slots live on the stack */
+#define MERGE_PATCH_STACK_SLOTS     16
+/* Returned by the comparisons, which otherwise return true or false */
+#define MERGE_PATCH_ERR             -1
+
+typedef struct {
+    uint32_t hash;
+    int val;    /* Token index of the value + 1, 0 if the slot is free */
+} merge_patch_slot_t;
+
+typedef struct {
+    jparse_ctx_t *jctx;
+    merge_patch_slot_t *slots;
+    uint32_t mask;
+    merge_patch_slot_t stack_slots[MERGE_PATCH_STACK_SLOTS];
+} merge_patch_table_t;
+
+static uint32_t merge_patch_hash(const char *key, int len)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static inline json_tok_t *tok(jparse_ctx_t *jctx, int index)
+{
+    return &jctx->tokens[index];
+}
+
+static inline int tok_len(json_tok_t *t)
+{
+    return t->end - t->start;
+}
+
+static inline bool tok_is_object(jparse_ctx_t *jctx, int index)
+{
+    return index >= 0 && tok(jctx, index)->type == JSMN_OBJECT;
+}
+
+static inline bool tok_is_null(jparse_ctx_t *jctx, int index)
+{
+    json_tok_t *t = tok(jctx, index);
+    return t->type == JSMN_PRIMITIVE && jctx->js[t->start] == 'n';
+}
+
+/* Indexes the members of the object at obj by key. Of repeated keys, only the last
+ * one is found.
+ */
+static int merge_patch_table_init(merge_patch_table_t *table, jparse_ctx_t *jctx, int obj)
+{
+    uint32_t num_slots = MERGE_PATCH_STACK_SLOTS;
+    int size = tok(jctx, obj)->size;
+    while (num_slots < (uint32_t)size * 2) {
+        num_slots <<= 1;
+    }
+    table->jctx = jctx;
+    table->mask = num_slots - 1;
+    if (num_slots == MERGE_PATCH_STACK_SLOTS) {
+        table->slots = table->stack_slots;
+        memset(table->slots, 0, sizeof(table->stack_slots));
+    } else {
+        table->slots = calloc(num_slots, sizeof(merge_patch_slot_t));
+        if (!table->slots) {
+            return -OS_FAIL;
+        }
+    }
+    int key = obj + 1;
+    for (int i = 0; i < size; i++) {
+        json_tok_t *t = tok(jctx, key);
+        uint32_t hash = merge_patch_hash(jctx->js + t->start, tok_len(t));
+        uint32_t slot = hash & table->mask;
+        /* A repeated key takes the slot of the earlier one, so that the last one wins */
+        while (table->slots[slot].val) {
+            json_tok_t *d = tok(jctx, table->slots[slot].val - 2);
+            if (table->slots[slot].hash == hash && tok_len(d) == tok_len(t)
+                    && memcmp(jctx->js + d->start, jctx->js + t->start, tok_len(t)) == 0) {
+                break;
+            }
+            slot = (slot + 1) & table->mask;
+        }
+        table->slots[slot].hash = hash;
+        table->slots[slot].val = key + 2;
+        key = t->next;
+    }
+    return OS_SUCCESS;
+}
+
+static void merge_patch_table_deinit(merge_patch_table_t *table)
+{
+    if (table->slots != table->stack_slots) {
+        free(table->slots);
+    }
+}
+
+/* Returns the token index of the value of key (the key token of another document), or -1 */
+static int merge_patch_table_find(merge_patch_table_t *table, jparse_ctx_t *jctx, int key)
+{
+    json_tok_t *k = tok(jctx, key);
+    const char *name = jctx->js + k->start;
+    int len = tok_len(k);
+    uint32_t hash = merge_patch_hash(name, len);
+    for (uint32_t slot = hash & table->mask; table->slots[slot].val; slot = (slot + 1) & table->mask) {
+        if (table->slots[slot].hash != hash) {
+            continue;
+        }
+        json_tok_t *t = tok(table->jctx, table->slots[slot].val - 2);
+        if (tok_len(t) == len && memcmp(table->jctx->js + t->start, name, len) == 0) {
+            return table->slots[slot].val - 1;
+        }
+    }
+    return -1;
+}
+
+/* Deep comparison, with object members in any order */
+static int merge_patch_equal(jparse_ctx_t *a, int ai, jparse_ctx_t *b, int bi, int depth)
+{
+    json_tok_t *at = tok(a, ai), *bt = tok(b, bi);
+    if (at->type != bt->type || at->size != bt->size) {
+        return false;
+    }
+    if ((at->type == JSMN_ARRAY || at->type == JSMN_OBJECT) && depth > MERGE_PATCH_MAX_DEPTH) {
+        return MERGE_PATCH_ERR;
+    }
+    if (at->type == JSMN_ARRAY) {
+        ai++;
+        bi++;
+        for (int i = 0; i < at->size; i++) {
+            int ret = merge_patch_equal(a, ai, b, bi, depth + 1);
+            if (ret != true) {
+                return ret;
+            }
+            ai = tok(a, ai)->next;
+            bi = tok(b, bi)->next;
+        }
+        return true;
+    }
+    if (at->type == JSMN_OBJECT) {
+        merge_patch_table_t table;
+        if (merge_patch_table_init(&table, a, ai) != OS_SUCCESS) {
+            return MERGE_PATCH_ERR;
+        }
+        int ret = true;
+        int key = bi + 1;
+        for (int i = 0; i < bt->size && ret == true; i++) {
+            int val = merge_patch_table_find(&table, b, key);
+            ret = val < 0 ? false : merge_patch_equal(a, val, b, key + 1, depth + 1);
+            key = tok(b, key)->next;
+        }
+        merge_patch_table_deinit(&table);
+        return ret;
+    }
+    return tok_len(at) == tok_len(bt) && memcmp(a->js + at->start, b->js + bt->start, tok_len(at)) == 0;
+}
+
+static inline void bit_set(uint8_t *bits, int index)
+{
+    bits[index >> 3] |= 1 << (index & 7);
+}
+
+static inline bool bit_get(uint8_t *bits, int index)
+{
+    return bits[index >> 3] & (1 << (index & 7));
+}
+
+/* First pass of the diff, over two objects. Marks each value of to which has to be
+ * emitted and returns whether the objects differ at all, so that the second pass never
+ * opens a nested object which would end up empty. Of repeated keys, only the last one
+ * is looked at, in both objects.
+ */
+static int merge_patch_mark(jparse_ctx_t *from, int fi, jparse_ctx_t *to, int ti, uint8_t *changed,
+                            int depth)
+{
+    merge_patch_table_t from_table, to_table;
+    if (depth > MERGE_PATCH_MAX_DEPTH || merge_patch_table_init(&from_table, from, fi) != OS_SUCCESS) {
+        return MERGE_PATCH_ERR;
+    }
+    if (merge_patch_table_init(&to_table, to, ti) != OS_SUCCESS) {
+        merge_patch_table_deinit(&from_table);
+        return MERGE_PATCH_ERR;
+    }
+    int ret = false;
+    int key = ti + 1;
+    for (int i = 0; i < tok(to, ti)->size && ret >= 0; i++) {
+        if (merge_patch_table_find(&to_table, to, key) != key + 1) {
+            key = tok(to, key)->next;
+            continue;
+        }
+        int val = merge_patch_table_find(&from_table, to, key);
+        if (val < 0) {
+            ret = true;
+        } else {
+            int diff;
+            if (tok_is_object(from, val) && tok_is_object(to, key + 1)) {
+                diff = merge_patch_mark(from, val, to, key + 1, changed, depth + 1);
+            } else {
+                diff = merge_patch_equal(from, val, to, key + 1, depth + 1);
+                diff = diff < 0 ? diff : !diff;
+            }
+            if (diff > 0) {
+                bit_set(changed, key + 1);
+                ret = true;
+            } else if (diff < 0) {
+                ret = diff;
+            }
+        }
+        key = tok(to, key)->next;
+    }
+    /* Members which were removed */
+    key = fi + 1;
+    for (int i = 0; i < tok(from, fi)->size && ret == false; i++) {
+        if (merge_patch_table_find(&to_table, from, key) < 0) {
+            ret = true;
+        }
+        key = tok(from, key)->next;
+    }
+    merge_patch_table_deinit(&to_table);
+    merge_patch_table_deinit(&from_table);
+    return ret;
+}
+
+/* Emits the value at index as is, as a member named by the key token at key, or as an
+ * array element (or the whole document) if key is -1
+ */
+static int merge_patch_set_raw(json_gen_str_t *jstr, jparse_ctx_t *kctx, int key,
+                               jparse_ctx_t *jctx, int index)
+{
+    json_tok_t *t = tok(jctx, index);
+    const char *val = jctx->js + t->start;
+    int len = tok_len(t);
+    /* Strings are emitted along with their quotes */
+    if (t->type == JSMN_STRING) {
+        val--;
+        len += 2;
+    }
+    if (key < 0) {
+        return json_gen_arr_set_raw(jstr, val, len);
+    }
+    json_tok_t *k = tok(kctx, key);
+    return json_gen_obj_set_raw_n(jstr, kctx->js + k->start, tok_len(k), val, len);
+}
+
+/* Second pass of the diff, emitting the members of the object patch */
+static int merge_patch_emit_diff(jparse_ctx_t *from, int fi, jparse_ctx_t *to, int ti,
+                                 uint8_t *changed, json_gen_str_t *jstr, int depth)
+{
+    merge_patch_table_t from_table, to_table;
+    if (depth > MERGE_PATCH_MAX_DEPTH || merge_patch_table_init(&from_table, from, fi) != OS_SUCCESS) {
+        return -OS_FAIL;
+    }
+    if (merge_patch_table_init(&to_table, to, ti) != OS_SUCCESS) {
+        merge_patch_table_deinit(&from_table);
+        return -OS_FAIL;
+    }
+    int ret = OS_SUCCESS;
+    int key = ti + 1;
+    for (int i = 0; i < tok(to, ti)->size && ret == OS_SUCCESS; i++) {
+        int val = merge_patch_table_find(&from_table, to, key);
+        if (merge_patch_table_find(&to_table, to, key) == key + 1 && (val < 0 || bit_get(changed, key + 1))) {
+            json_tok_t *k = tok(to, key);
+            if (val >= 0 && tok_is_object(from, val) && tok_is_object(to, key + 1)) {
+                ret = json_gen_push_object_n(jstr, to->js + k->start, tok_len(k));
+                if (ret == OS_SUCCESS) {
+                    ret = merge_patch_emit_diff(from, val, to, key + 1, changed, jstr, depth + 1);
+                }
+                if (ret == OS_SUCCESS) {
+                    ret = json_gen_pop_object(jstr);
+                }
+            } else {
+                ret = merge_patch_set_raw(jstr, to, key, to, key + 1);
+            }
+        }
+        key = tok(to, key)->next;
+    }
+
+    /* Members which were removed */
+    key = fi + 1;
+    for (int i = 0; i < tok(from, fi)->size && ret == OS_SUCCESS; i++) {
+        if (merge_patch_table_find(&from_table, from, key) == key + 1
+                && merge_patch_table_find(&to_table, from, key) < 0) {
+            json_tok_t *k = tok(from, key);
+            ret = json_gen_obj_set_null_n(jstr, from->js + k->start, tok_len(k));
+        }
+        key = tok(from, key)->next;
+    }
+    merge_patch_table_deinit(&to_table);
+    merge_patch_table_deinit(&from_table);
+    return ret == OS_SUCCESS ? OS_SUCCESS : -OS_FAIL;
+}
+
+int json_merge_patch_diff(jparse_ctx_t *from, jparse_ctx_t *to, json_gen_str_t *jstr)
+{
+    if (!from || !to || !jstr || from->num_tokens < 1 || to->num_tokens < 1) {
+        return -OS_FAIL;
+    }
+    /* Anything but an object replaces the whole document */
+    if (!tok_is_object(from, 0) || !tok_is_object(to, 0)) {
+        return merge_patch_set_raw(jstr, NULL, -1, to, 0) == OS_SUCCESS ? OS_SUCCESS : -OS_FAIL;
+    }
+    uint8_t *changed = calloc((to->num_tokens + 7) / 8, 1);
+    if (!changed) {
+        return -OS_FAIL;
+    }
+    int ret = merge_patch_mark(from, 0, to, 0, changed, 0);
+    if (ret >= 0) {
+        bool differ = ret;
+        ret = json_gen_start_object(jstr);
+        if (ret == OS_SUCCESS && differ) {
+            ret = merge_patch_emit_diff(from, 0, to, 0, changed, jstr, 0);
+        }
+        if (ret == OS_SUCCESS) {
+            ret = json_gen_end_object(jstr);
+        }
+    }
+    free(changed);
+    return ret == OS_SUCCESS ? OS_SUCCESS : -OS_FAIL;
+}
+
+/* Emits MergePatch(target value, patch value) as in RFC 7386. ti is -1 if there is no
+ * target value. The member is named by the key token at key of kctx, if key is not -1.
+ * Of repeated keys, in the target or in the patch, only the last one counts.
+ */
+static int merge_patch_emit_apply(jparse_ctx_t *target, int ti, jparse_ctx_t *patch, int pi,
+                                  jparse_ctx_t *kctx, int key, json_gen_str_t *jstr, int depth)
+{
+    if (!tok_is_object(patch, pi)) {
+        return merge_patch_set_raw(jstr, kctx, key, patch, pi);
+    }
+    if (depth > MERGE_PATCH_MAX_DEPTH) {
+        return -OS_FAIL;
+    }
+    merge_patch_table_t patch_table, target_table;
+    int ret;
+    if (key < 0) {
+        ret = json_gen_start_object(jstr);
+    } else {
+        json_tok_t *k = tok(kctx, key);
+        ret = json_gen_push_object_n(jstr, kctx->js + k->start, tok_len(k));
+    }
+    if (ret != OS_SUCCESS || merge_patch_table_init(&patch_table, patch, pi) != OS_SUCCESS) {
+        return -OS_FAIL;
+    }
+    bool merge = tok_is_object(target, ti);
+
+    /* Members of the target, in their original order */
+    if (merge) {
+        if (merge_patch_table_init(&target_table, target, ti) != OS_SUCCESS) {
+            merge_patch_table_deinit(&patch_table);
+            return -OS_FAIL;
+        }
+        int member = ti + 1;
+        for (int i = 0; i < tok(target, ti)->size && ret == OS_SUCCESS; i++) {
+            if (merge_patch_table_find(&target_table, target, member) == member + 1) {
+                int val = merge_patch_table_find(&patch_table, target, member);
+                if (val < 0) {
+                    ret = merge_patch_set_raw(jstr, target, member, target, member + 1);
+                } else if (!tok_is_null(patch, val)) {
+                    ret = merge_patch_emit_apply(target, member + 1, patch, val, target, member, jstr, depth + 1);
+                }
+            }
+            member = tok(target, member)->next;
+        }
+    }
+
+    /* Members added by the patch */
+    int member = pi + 1;
+    for (int i = 0; i < tok(patch, pi)->size && ret == OS_SUCCESS; i++) {
+        if (!tok_is_null(patch, member + 1) && merge_patch_table_find(&patch_table, patch, member) == member + 1
+                && (!merge || merge_patch_table_find(&target_table, patch, member) < 0)) {
+            ret = merge_patch_emit_apply(target, -1, patch, member + 1, patch, member, jstr, depth + 1);
+        }
+        member = tok(patch, member)->next;
+    }
+    if (merge) {
+        merge_patch_table_deinit(&target_table);
+    }
+    merge_patch_table_deinit(&patch_table);
+    if (ret != OS_SUCCESS) {
+        return -OS_FAIL;
+    }
+    return key < 0 ? json_gen_end_object(jstr) : json_gen_pop_object(jstr);
+}
+
+int json_merge_patch_apply(jparse_ctx_t *target, jparse_ctx_t *patch, json_gen_str_t *jstr)
+{
+    if (!target || !patch || !jstr || target->num_tokens < 1 || patch->num_tokens < 1) {
+        return -OS_FAIL;
+    }
+    return merge_patch_emit_apply(target, 0, patch, 0, NULL, -1, jstr, 0) == OS_SUCCESS ? OS_SUCCESS : -OS_FAIL;
+}
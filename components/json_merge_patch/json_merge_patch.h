@@ -0,0 +1,60 @@
+// Copyright 2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/*
+ * JSON Merge Patch (RFC 7386) over documents parsed with json_parser.
+ *
+ * Both functions write a single JSON value to jstr, so they are meant to be called
+ * between json_gen_str_start() and json_gen_str_end(). Values which are copied over
+ * unchanged are emitted from the raw text of the source document.
+ *
+ * Objects are matched member by member through a hash of the raw keys, so both run in
+ * time linear in the number of tokens. Keys are compared as they appear in the text
+ * (escapes are not decoded) and numbers by their text, so 1.0 and 1 count as different.
+ * As with any merge patch, a null value in the new document cannot be represented and
+ * ends up deleting the member instead. Of repeated keys in an object, the last one wins.
+ *
+ * Both recurse once per level of nested objects (and arrays, when comparing) and fail on
+ * documents nested deeper than MERGE_PATCH_MAX_DEPTH.
+ */
+
+#include <json_parser.h>
+#include <json_generator.h>
+
+/* Each level takes two key tables of 16 slots on the stack (objects with more than 8
+ * members get theirs from the heap), about 350 bytes per level on a 32 bit target
+ * and 500 on a 64 bit host. The default limit of 8 thus needs up to 3-4 KB of stack
+ * for the recursion. Raise it only along with the stack of the calling task.
+ */
+#ifndef MERGE_PATCH_MAX_DEPTH
+#define MERGE_PATCH_MAX_DEPTH   8
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Writes the merge patch which turns the document in from into the one in to.
+ * If both are objects and equal, the patch is an empty object.
+ */
+int json_merge_patch_diff(jparse_ctx_t *from, jparse_ctx_t *to, json_gen_str_t *jstr);
+
+/* Writes the result of applying patch to the document in target */
+int json_merge_patch_apply(jparse_ctx_t *target, jparse_ctx_t *patch, json_gen_str_t *jstr);
+
+#ifdef __cplusplus
+}
+#endif
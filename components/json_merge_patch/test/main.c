@@ -0,0 +1,187 @@
+// Copyright 2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/* Host test for json_merge_patch. Build and run with "make" in this directory */
+
+#include <stdio.h>
+#include <string.h>
+#include <json_merge_patch.h>
+
+#define TEST_BUF_SIZE   512
+
+typedef struct {
+    const char *target;
+    const char *patch;
+    const char *result;
+} merge_patch_vector_t;
+
+/* RFC 7386, Appendix A */
+static const merge_patch_vector_t rfc_vectors[] = {
+    {"{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+    {"{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}"},
+    {"{\"a\":\"b\"}", "{\"a\":null}", "{}"},
+    {"{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}"},
+    {"{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+    {"{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":[\"b\"]}"},
+    {"{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}"},
+    {"{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}", "{\"a\":[1]}"},
+    {"[\"a\",\"b\"]", "[\"c\",\"d\"]", "[\"c\",\"d\"]"},
+    {"{\"a\":\"b\"}", "[\"c\"]", "[\"c\"]"},
+    {"{\"a\":\"foo\"}", "null", "null"},
+    {"{\"a\":\"foo\"}", "\"bar\"", "\"bar\""},
+    {"{\"e\":null}", "{\"a\":1}", "{\"e\":null,\"a\":1}"},
+    {"[1,2]", "{\"a\":\"b\",\"c\":null}", "{\"a\":\"b\"}"},
+    {"{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}"},
+};
+
+/* Repeated keys, of which the last one wins */
+static const merge_patch_vector_t dup_vectors[] = {
+    {"{\"a\":1}", "{\"b\":1,\"b\":2}", "{\"a\":1,\"b\":2}"},
+    {"{\"a\":1}", "{\"a\":null,\"a\":3}", "{\"a\":3}"},
+    {"{\"a\":1}", "{\"a\":3,\"a\":null}", "{}"},
+    {"{\"a\":1,\"a\":2}", "{}", "{\"a\":2}"},
+};
+
+typedef struct {
+    const char *from;
+    const char *to;
+    const char *diff;
+} merge_patch_diff_vector_t;
+
+static const merge_patch_diff_vector_t diff_vectors[] = {
+    {"{\"a\":\"b\",\"b\":\"c\"}", "{\"b\":\"c\"}", "{\"a\":null}"},
+    {"{\"a\":{\"b\":\"c\",\"d\":1}}", "{\"a\":{\"b\":\"d\",\"d\":1}}", "{\"a\":{\"b\":\"d\"}}"},
+    {"{\"a\":[1,{\"b\":2}]}", "{\"a\":[1,{\"b\":3}]}", "{\"a\":[1,{\"b\":3}]}"},
+    {"{\"a\":{\"x\":1,\"y\":[2]}}", "{\"a\":{\"y\":[2],\"x\":1}}", "{}"},
+    {"{\"a\":1}", "[1]", "[1]"},
+    {"{\"a\":1}", "null", "null"},
+};
+
+/* Repeated keys in the diff, also last one wins */
+static const merge_patch_diff_vector_t dup_diff_vectors[] = {
+    {"{\"a\":2}", "{\"a\":1,\"a\":2}", "{}"},
+    {"{\"a\":1}", "{\"a\":2,\"a\":3}", "{\"a\":3}"},
+    {"{\"a\":{\"x\":1}}", "{\"a\":{\"x\":1},\"a\":{\"x\":2}}", "{\"a\":{\"x\":2}}"},
+    {"{\"a\":1,\"b\":1,\"b\":2}", "{\"a\":1}", "{\"b\":null}"},
+    {"{\"a\":1,\"a\":2}", "{\"a\":2}", "{}"},
+};
+
+static int run(const char *a_str, const char *b_str, bool diff, char *out)
+{
+    char a_buf[TEST_BUF_SIZE], b_buf[TEST_BUF_SIZE];
+    jparse_ctx_t a, b;
+    json_gen_str_t jstr;
+    /* json_parser (in strict mode) needs a primitive at the top level to be followed by something */
+    snprintf(a_buf, sizeof(a_buf), "%s\n", a_str);
+    snprintf(b_buf, sizeof(b_buf), "%s\n", b_str);
+    if (json_parse_start(&a, a_buf, strlen(a_buf)) != OS_SUCCESS) {
+        return -OS_FAIL;
+    }
+    if (json_parse_start(&b, b_buf, strlen(b_buf)) != OS_SUCCESS) {
+        json_parse_end(&a);
+        return -OS_FAIL;
+    }
+    json_gen_str_start(&jstr, out, TEST_BUF_SIZE, NULL, NULL);
+    int ret = diff ? json_merge_patch_diff(&a, &b, &jstr) : json_merge_patch_apply(&a, &b, &jstr);
+    json_gen_str_end(&jstr);
+    json_parse_end(&a);
+    json_parse_end(&b);
+    return ret;
+}
+
+static int test_apply(const merge_patch_vector_t *vectors, int count)
+{
+    char out[TEST_BUF_SIZE];
+    for (int i = 0; i < count; i++) {
+        if (run(vectors[i].target, vectors[i].patch, false, out) != OS_SUCCESS
+                || strcmp(out, vectors[i].result) != 0) {
+            printf("Apply %s to %s\nGot %s\nExpected %s\n", vectors[i].patch, vectors[i].target,
+                   out, vectors[i].result);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* The diff of each RFC vector, applied to its target, must give the result back */
+static int test_diff_round_trip(void)
+{
+    char diff[TEST_BUF_SIZE], out[TEST_BUF_SIZE];
+    for (size_t i = 0; i < sizeof(rfc_vectors) / sizeof(rfc_vectors[0]); i++) {
+        const merge_patch_vector_t *v = &rfc_vectors[i];
+        if (run(v->target, v->result, true, diff) != OS_SUCCESS
+                || run(v->target, diff, false, out) != OS_SUCCESS || strcmp(out, v->result) != 0) {
+            printf("Diff from %s to %s\nGot %s, which gives %s\n", v->target, v->result, diff, out);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int test_diff(const merge_patch_diff_vector_t *vectors, int count)
+{
+    char out[TEST_BUF_SIZE];
+    for (int i = 0; i < count; i++) {
+        const merge_patch_diff_vector_t *v = &vectors[i];
+        if (run(v->from, v->to, true, out) != OS_SUCCESS || strcmp(out, v->diff) != 0) {
+            printf("Diff from %s to %s\nGot %s\nExpected %s\n", v->from, v->to, out, v->diff);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void nested_str(char *buf, int levels)
+{
+    int len = 0;
+    for (int i = 0; i < levels; i++) {
+        len += sprintf(buf + len, "{\"a\":");
+    }
+    len += sprintf(buf + len, "1");
+    for (int i = 0; i < levels; i++) {
+        len += sprintf(buf + len, "}");
+    }
+}
+
+/* Objects nested beyond MERGE_PATCH_MAX_DEPTH fail instead of recursing further */
+static int test_depth(void)
+{
+    char deepest[TEST_BUF_SIZE], too_deep[TEST_BUF_SIZE], out[TEST_BUF_SIZE];
+    /* The top level object is at depth 0 */
+    nested_str(deepest, MERGE_PATCH_MAX_DEPTH + 1);
+    nested_str(too_deep, MERGE_PATCH_MAX_DEPTH + 2);
+    if (run(deepest, deepest, true, out) != OS_SUCCESS || strcmp(out, "{}") != 0
+            || run("{}", deepest, false, out) != OS_SUCCESS || strcmp(out, deepest) != 0) {
+        printf("Failed at depth %d\n", MERGE_PATCH_MAX_DEPTH);
+        return -1;
+    }
+    if (run("{}", too_deep, false, out) == OS_SUCCESS || run(too_deep, too_deep, true, out) == OS_SUCCESS) {
+        printf("Did not fail at depth %d\n", MERGE_PATCH_MAX_DEPTH + 1);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (test_apply(rfc_vectors, sizeof(rfc_vectors) / sizeof(rfc_vectors[0])) != 0
+            || test_apply(dup_vectors, sizeof(dup_vectors) / sizeof(dup_vectors[0])) != 0
+            || test_diff(diff_vectors, sizeof(diff_vectors) / sizeof(diff_vectors[0])) != 0
+            || test_diff(dup_diff_vectors, sizeof(dup_diff_vectors) / sizeof(dup_diff_vectors[0])) != 0 || test_diff_round_trip() != 0 || test_depth() != 0) {
+        printf("Test Failed!\n");
+        return -1;
+    }
+    printf("Test Passed!\n");
+    return 0;
+}
@@ -1,2 +1,4 @@
 COMPONENT_SRCDIRS := upstream/src
 COMPONENT_ADD_INCLUDEDIRS := upstream/include upstream
+# json_batch.c needs pthreads and is left out, as in CMakeLists.txt
+COMPONENT_OBJEXCLUDE := upstream/src/json_batch.o
@@ -0,0 +1,98 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef _CBOR_PARSER_H_
+#define _CBOR_PARSER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* CBOR (RFC 8949) parser with the same accessors as json_parser.h, with cbor_
+ * in place of json_, e.g. cbor_obj_get_float() for json_obj_get_float().
+ *
+ * There are no tokens. cbor_parse_start() checks that the buffer holds exactly
+ * one well formed map or array, and the accessors then find values by skipping
+ * over items in place, which is cheap since CBOR items carry their lengths.
+ * Both definite and indefinite lengths are supported, as are half, single and
+ * double precision floats. Tags are not interpreted. Map keys must be text
+ * strings with definite lengths to be found.
+ */
+
+#ifndef OS_SUCCESS
+#define OS_SUCCESS  0
+#endif
+#ifndef OS_FAIL
+#define OS_FAIL     -1
+#endif
+
+#ifndef CBOR_PARSER_MAX_DEPTH
+#define CBOR_PARSER_MAX_DEPTH	16
+#endif
+
+typedef struct {
+	const uint8_t *buf;
+	int len;
+	/* Current map or array */
+	const uint8_t *cur;
+	/* Maps and arrays entered with the get_object/get_array calls */
+	const uint8_t *stack[CBOR_PARSER_MAX_DEPTH];
+	int depth;
+	/* Last element looked up by index in the current array */
+	const uint8_t *elem;
+	uint32_t elem_index;
+} cbor_parse_ctx_t;
+
+int cbor_parse_start(cbor_parse_ctx_t *ctx, const uint8_t *buf, int len);
+int cbor_parse_end(cbor_parse_ctx_t *ctx);
+
+int cbor_obj_get_array(cbor_parse_ctx_t *ctx, char *name, int *num_elem);
+int cbor_obj_leave_array(cbor_parse_ctx_t *ctx);
+int cbor_obj_get_object(cbor_parse_ctx_t *ctx, char *name);
+int cbor_obj_leave_object(cbor_parse_ctx_t *ctx);
+int cbor_obj_get_bool(cbor_parse_ctx_t *ctx, char *name, bool *val);
+int cbor_obj_get_int(cbor_parse_ctx_t *ctx, char *name, int *val);
+int cbor_obj_get_int64(cbor_parse_ctx_t *ctx, char *name, int64_t *val);
+/* Integers are accepted as well */
+int cbor_obj_get_float(cbor_parse_ctx_t *ctx, char *name, float *val);
+int cbor_obj_get_string(cbor_parse_ctx_t *ctx, char *name, char *val, int size);
+int cbor_obj_get_strlen(cbor_parse_ctx_t *ctx, char *name, int *strlen);
+int cbor_obj_get_int_array(cbor_parse_ctx_t *ctx, char *name, int *val, int max_elem, int *num_elem);
+int cbor_obj_get_int64_array(cbor_parse_ctx_t *ctx, char *name, int64_t *val, int max_elem, int *num_elem);
+int cbor_obj_get_float_array(cbor_parse_ctx_t *ctx, char *name, float *val, int max_elem, int *num_elem);
+
+int cbor_arr_get_array(cbor_parse_ctx_t *ctx, uint32_t index);
+int cbor_arr_leave_array(cbor_parse_ctx_t *ctx);
+int cbor_arr_get_object(cbor_parse_ctx_t *ctx, uint32_t index);
+int cbor_arr_leave_object(cbor_parse_ctx_t *ctx);
+int cbor_arr_get_bool(cbor_parse_ctx_t *ctx, uint32_t index, bool *val);
+int cbor_arr_get_int(cbor_parse_ctx_t *ctx, uint32_t index, int *val);
+int cbor_arr_get_int64(cbor_parse_ctx_t *ctx, uint32_t index, int64_t *val);
+int cbor_arr_get_float(cbor_parse_ctx_t *ctx, uint32_t index, float *val);
+int cbor_arr_get_string(cbor_parse_ctx_t *ctx, uint32_t index, char *val, int size);
+int cbor_arr_get_strlen(cbor_parse_ctx_t *ctx, uint32_t index, int *strlen);
+int cbor_arr_get_int_array(cbor_parse_ctx_t *ctx, uint32_t index, int *val, int max_elem, int *num_elem);
+int cbor_arr_get_int64_array(cbor_parse_ctx_t *ctx, uint32_t index, int64_t *val, int max_elem, int *num_elem);
+int cbor_arr_get_float_array(cbor_parse_ctx_t *ctx, uint32_t index, float *val, int max_elem, int *num_elem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CBOR_PARSER_H_ */
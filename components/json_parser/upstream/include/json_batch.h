@@ -0,0 +1,62 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef _JSON_BATCH_H_
+#define _JSON_BATCH_H_
+
+#include <json_parser.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Parallel parsing of batches of documents, for hosts with POSIX threads.
+ * Not part of the ESP-IDF component.
+ *
+ * Documents are handed out to a pool of worker threads, each with its own
+ * growable token arena, so steady state parsing does not allocate. The callback
+ * runs on the worker thread while the document is parsed, and gets the index of
+ * the document in the batch. Storing results at that index in an array keeps them
+ * in the order of the batch, even though documents complete in any order.
+ */
+
+typedef struct {
+	char *js;
+	int len;
+} json_batch_doc_t;
+
+/* jctx is NULL if the document failed to parse. Callbacks for different documents
+ * run concurrently. Return anything other than OS_SUCCESS to mark the document failed.
+ */
+typedef int (*json_batch_cb_t)(jparse_ctx_t *jctx, int index, void *priv);
+
+/* num_threads <= 0 uses one thread per online CPU. Returns OS_SUCCESS if every
+ * document was parsed and accepted by the callback.
+ */
+int json_batch_parse(const json_batch_doc_t *docs, int num_docs, int num_threads,
+		json_batch_cb_t cb, void *priv);
+
+/* Same, for newline delimited documents in a single buffer. Empty lines are skipped
+ * and not counted. On success, num_docs (if not NULL) gets the number of documents.
+ */
+int json_batch_parse_lines(char *buf, int len, int num_threads, json_batch_cb_t cb,
+		void *priv, int *num_docs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _JSON_BATCH_H_ */
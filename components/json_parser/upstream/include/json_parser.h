@@ -16,6 +16,27 @@
 #ifndef _JSON_PARSER_H_
 #define _JSON_PARSER_H_
 
+/* Token layout must match the one json_parser.c is compiled with, since
+ * callers may now own the token storage (see json_parse_start_static())
+ */
+#ifdef JSON_PARSER_COMPACT_TOKENS
+/* 8 byte tokens, for documents under 64 KB with containers of under 8192 elements.
+ * Must be defined for every file including this one.
+ */
+#ifndef JSMN_COMPACT
+#define JSMN_COMPACT
+#endif
+#else
+#ifndef JSMN_PARENT_LINKS
+#define JSMN_PARENT_LINKS
+#endif
+#endif
+#ifndef JSMN_NEXT_LINKS
+#define JSMN_NEXT_LINKS
+#endif
+#ifndef JSMN_FAST_SCAN
+#define JSMN_FAST_SCAN
+#endif
 #define JSMN_HEADER
 #include <jsmn/jsmn.h>
 #include <stdint.h>
@@ -31,6 +52,7 @@ extern "C"
 
 typedef jsmn_parser json_parser_t;
 typedef jsmntok_t json_tok_t;
+typedef struct json_obj_index json_obj_index_t;
 
 typedef struct {
 	json_parser_t parser;
@@ -38,11 +60,64 @@ typedef struct {
 	json_tok_t *tokens;
 	json_tok_t *cur;
 	int num_tokens;
+	bool tokens_borrowed;
+	bool obj_index_enabled;
+	json_obj_index_t *obj_index;
+	/* Last element found by json_arr_search(), for sequential access to arrays */
+	json_tok_t *arr_cache;
+	json_tok_t *arr_cache_elem;
+	uint32_t arr_cache_index;
 } jparse_ctx_t;
 
+/* Reusable token storage.
+ *
+ * A fixed arena wraps a caller supplied token array and parsing fails cleanly
+ * if the document needs more tokens. A growable arena owns a heap array which
+ * is doubled (and the parse resumed, not restarted) whenever it runs short.
+ * The array is retained across parses, so repeated parsing of similar sized
+ * documents does not touch the heap once the arena has warmed up.
+ */
+typedef struct {
+	json_tok_t *tokens;
+	int num_tokens;
+	bool growable;
+} json_tok_arena_t;
+
+/* Forward iterator over the elements of an array or the members of an object */
+typedef struct {
+	jparse_ctx_t *jctx;
+	/* Current element of an array, or key of the current member of an object */
+	json_tok_t *elem;
+	int remaining;
+	bool is_object;
+} json_iter_t;
+
 int json_parse_start(jparse_ctx_t *jctx, char *js, int len);
+int json_parse_start_static(jparse_ctx_t *jctx, char *js, int len, json_tok_t *buf, int buf_len);
+int json_parse_start_arena(jparse_ctx_t *jctx, json_tok_arena_t *arena, char *js, int len);
+/* Parses just the members named in keys (at most JSON_PARSE_LAZY_MAX_KEYS) of the top level
+ * object, stopping as soon as all of them have been found. Other members are skipped by
+ * matching quotes and brackets, without being tokenized or validated. The resulting jctx
+ * behaves as if the object had only the members found.
+ */
+int json_parse_start_lazy(jparse_ctx_t *jctx, char *js, int len, char **keys, int num_keys);
+/* Same as json_parse_start_lazy(), with the tokens going into an arena of the caller's */
+int json_parse_start_lazy_arena(jparse_ctx_t *jctx, json_tok_arena_t *arena, char *js, int len,
+		char **keys, int num_keys);
 int json_parse_end(jparse_ctx_t *jctx);
 
+/* buf NULL creates a growable arena with an initial capacity of num_tokens */
+void json_tok_arena_init(json_tok_arena_t *arena, json_tok_t *buf, int num_tokens);
+void json_tok_arena_free(json_tok_arena_t *arena);
+
+/* Enable hashed key lookups for the json_obj_get_*() APIs on a parsed document.
+ * Nothing is allocated here. An object gets indexed the first time a key is
+ * looked up in it (if it has at least JSON_OBJ_INDEX_MIN_KEYS members) and all
+ * later lookups in that object are O(1). Each indexed object gets a table of its
+ * own, of 16 to 32 bytes per member. Freed by json_parse_end().
+ */
+int json_obj_index_enable(jparse_ctx_t *jctx);
+
 int json_obj_get_array(jparse_ctx_t *jctx, char *name, int *num_elem);
 int json_obj_leave_array(jparse_ctx_t *jctx);
 int json_obj_get_object(jparse_ctx_t *jctx, char *name);
@@ -51,12 +126,25 @@ int json_obj_get_bool(jparse_ctx_t *jctx, char *name, bool *val);
 int json_obj_get_int(jparse_ctx_t *jctx, char *name, int *val);
 int json_obj_get_int64(jparse_ctx_t *jctx, char *name, int64_t *val);
 int json_obj_get_float(jparse_ctx_t *jctx, char *name, float *val);
+/* Gets a number as val * 10^scale, rounded, e.g. 23.456 with scale 2 gives 2346 */
+int json_obj_get_fixed(jparse_ctx_t *jctx, char *name, int scale, int32_t *val);
 int json_obj_get_string(jparse_ctx_t *jctx, char *name, char *val, int size);
 int json_obj_get_strlen(jparse_ctx_t *jctx, char *name, int *strlen);
+/* Points val to the raw string in the JSON buffer, without copying. Not NULL terminated */
+int json_obj_get_strview(jparse_ctx_t *jctx, char *name, char **val, int *len);
+/* Decodes all escapes (including \uXXXX, to UTF-8) in the JSON buffer itself and
+ * NULL terminates the string there. The raw text of the objects and arrays containing
+ * it is no longer valid after this.
+ */
+int json_obj_get_string_inplace(jparse_ctx_t *jctx, char *name, char **val, int *len);
 int json_obj_get_object_str(jparse_ctx_t *jctx, char *name, char *val, int size);
 int json_obj_get_object_strlen(jparse_ctx_t *jctx, char *name, int *strlen);
 int json_obj_get_array_str(jparse_ctx_t *jctx, char *name, char *val, int size);
 int json_obj_get_array_strlen(jparse_ctx_t *jctx, char *name, int *strlen);
+/* Decode a whole array of numbers in one go. Fails if it has more than max_elem elements */
+int json_obj_get_int_array(jparse_ctx_t *jctx, char *name, int *val, int max_elem, int *num_elem);
+int json_obj_get_int64_array(jparse_ctx_t *jctx, char *name, int64_t *val, int max_elem, int *num_elem);
+int json_obj_get_float_array(jparse_ctx_t *jctx, char *name, float *val, int max_elem, int *num_elem);
 
 int json_arr_get_array(jparse_ctx_t *jctx, uint32_t index);
 int json_arr_leave_array(jparse_ctx_t *jctx);
@@ -66,8 +154,44 @@ int json_arr_get_bool(jparse_ctx_t *jctx, uint32_t index, bool *val);
 int json_arr_get_int(jparse_ctx_t *jctx, uint32_t index, int *val);
 int json_arr_get_int64(jparse_ctx_t *jctx, uint32_t index, int64_t *val);
 int json_arr_get_float(jparse_ctx_t *jctx, uint32_t index, float *val);
+int json_arr_get_fixed(jparse_ctx_t *jctx, uint32_t index, int scale, int32_t *val);
 int json_arr_get_string(jparse_ctx_t *jctx, uint32_t index, char *val, int size);
 int json_arr_get_strlen(jparse_ctx_t *jctx, uint32_t index, int *strlen);
+int json_arr_get_strview(jparse_ctx_t *jctx, uint32_t index, char **val, int *len);
+int json_arr_get_string_inplace(jparse_ctx_t *jctx, uint32_t index, char **val, int *len);
+int json_arr_get_int_array(jparse_ctx_t *jctx, uint32_t index, int *val, int max_elem, int *num_elem);
+int json_arr_get_int64_array(jparse_ctx_t *jctx, uint32_t index, int64_t *val, int max_elem, int *num_elem);
+int json_arr_get_float_array(jparse_ctx_t *jctx, uint32_t index, float *val, int max_elem, int *num_elem);
+
+/* Iterators do not change jctx->cur, so nested containers can be walked with
+ * json_iter_begin_child() without any leave calls. Every step is O(1).
+ *
+ *	json_iter_t it;
+ *	for (json_iter_begin(jctx, &it); !json_iter_end(&it); json_iter_next(&it)) {
+ *		...
+ *	}
+ */
+int json_iter_begin(jparse_ctx_t *jctx, json_iter_t *iter);
+int json_iter_begin_child(json_iter_t *parent, json_iter_t *iter);
+bool json_iter_end(json_iter_t *iter);
+void json_iter_next(json_iter_t *iter);
+jsmntype_t json_iter_get_type(json_iter_t *iter);
+/* For objects only. The key is not NULL terminated */
+int json_iter_get_key(json_iter_t *iter, char **key, int *len);
+bool json_iter_key_matches(json_iter_t *iter, char *key);
+int json_iter_get_bool(json_iter_t *iter, bool *val);
+int json_iter_get_int(json_iter_t *iter, int *val);
+int json_iter_get_int64(json_iter_t *iter, int64_t *val);
+int json_iter_get_float(json_iter_t *iter, float *val);
+int json_iter_get_fixed(json_iter_t *iter, int scale, int32_t *val);
+int json_iter_get_string(json_iter_t *iter, char *val, int size);
+/* Same as json_iter_get_string(), but with the escapes decoded as for the _inplace()
+ * APIs, leaving the JSON buffer as it is. Fails if the decoded string does not fit.
+ */
+int json_iter_get_string_decoded(json_iter_t *iter, char *val, int size);
+int json_iter_get_strlen(json_iter_t *iter, int *strlen);
+int json_iter_get_strview(json_iter_t *iter, char **val, int *len);
+int json_iter_get_string_inplace(json_iter_t *iter, char **val, int *len);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,87 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef _JSON_PATH_H_
+#define _JSON_PATH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <json_parser.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Compiled path queries.
+ *
+ * A path in JSON Pointer (RFC 6901) syntax, e.g. "/state/desired/channels/3/rate_ms",
+ * is compiled once into a list of steps, which can then be looked up in any number
+ * of parsed documents. Paths are always looked up from the root of the document,
+ * irrespective of the current object. A step which is a valid array index can match
+ * either an array element or an object member with that name.
+ *
+ * Several paths can be looked up together with json_path_find_multi(), which visits
+ * every container on the way to any of them just once, instead of once per path.
+ */
+
+#ifndef JSON_PATH_MAX_STEPS
+#define JSON_PATH_MAX_STEPS	8
+#endif
+
+/* Total length of all the keys in a path */
+#ifndef JSON_PATH_MAX_KEYS_LEN
+#define JSON_PATH_MAX_KEYS_LEN	64
+#endif
+
+/* Maximum number of paths for json_path_find_multi() */
+#define JSON_PATH_MAX_MULTI	32
+
+typedef struct {
+	uint8_t num_steps;
+	struct {
+		uint8_t key_offset;
+		uint8_t key_len;
+		/* -1 if the step is not a valid array index */
+		int32_t index;
+	} steps[JSON_PATH_MAX_STEPS];
+	char keys[JSON_PATH_MAX_KEYS_LEN];
+} json_path_t;
+
+int json_path_compile(json_path_t *path, const char *str);
+
+/* On success, val is positioned at the value found, so that the json_iter_get_*()
+ * APIs can be used to read it, or json_iter_begin_child() to walk it.
+ */
+int json_path_find(jparse_ctx_t *jctx, const json_path_t *path, json_iter_t *val);
+
+/* Looks up num_paths (at most JSON_PATH_MAX_MULTI) paths in a single traversal.
+ * Returns a bitmask with bit i set if paths[i] was found, in which case vals[i]
+ * is positioned at its value.
+ */
+uint32_t json_path_find_multi(jparse_ctx_t *jctx, const json_path_t *paths, int num_paths,
+		json_iter_t *vals);
+
+int json_path_get_bool(jparse_ctx_t *jctx, const json_path_t *path, bool *val);
+int json_path_get_int(jparse_ctx_t *jctx, const json_path_t *path, int *val);
+int json_path_get_int64(jparse_ctx_t *jctx, const json_path_t *path, int64_t *val);
+int json_path_get_float(jparse_ctx_t *jctx, const json_path_t *path, float *val);
+int json_path_get_string(jparse_ctx_t *jctx, const json_path_t *path, char *val, int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _JSON_PATH_H_ */
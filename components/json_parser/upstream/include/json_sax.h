@@ -0,0 +1,97 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef _JSON_SAX_H_
+#define _JSON_SAX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <json_parser.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Streaming (SAX style) parser.
+ *
+ * The document can be fed in chunks of any size, as they are received, and
+ * events are reported through a callback. Memory use does not depend on the
+ * size of the document, only on the nesting depth.
+ *
+ * Keys and numbers are collected internally and always reported as a whole.
+ * String values are reported as they arrive, possibly split across several
+ * JSON_SAX_STRING events, with "partial" set on all but the last one. Like
+ * json_obj_get_string(), string data is reported raw, without decoding escapes.
+ */
+
+#ifndef JSON_SAX_MAX_DEPTH
+#define JSON_SAX_MAX_DEPTH	32
+#endif
+
+#if JSON_SAX_MAX_DEPTH < 1 || JSON_SAX_MAX_DEPTH > 255
+#error "JSON_SAX_MAX_DEPTH must be between 1 and 255"
+#endif
+
+#ifndef JSON_SAX_MAX_KEY_LEN
+#define JSON_SAX_MAX_KEY_LEN	64
+#endif
+
+typedef enum {
+	JSON_SAX_OBJECT_START,
+	JSON_SAX_OBJECT_END,
+	JSON_SAX_ARRAY_START,
+	JSON_SAX_ARRAY_END,
+	JSON_SAX_KEY,
+	JSON_SAX_STRING,
+	JSON_SAX_NUMBER,
+	JSON_SAX_BOOL,
+	JSON_SAX_NULL,
+} json_sax_event_t;
+
+/* val/len point to the key, string fragment, number or literal (true/false/null)
+ * text and are valid only during the callback. Returning anything other than
+ * OS_SUCCESS aborts the parsing.
+ */
+typedef int (*json_sax_cb_t)(json_sax_event_t event, const char *val, int len,
+		bool partial, void *priv);
+
+typedef struct {
+	json_sax_cb_t cb;
+	void *priv;
+	uint8_t state;
+	uint8_t depth;
+	uint8_t pos;
+	bool is_key;
+	/* One bit per nesting level, set for objects */
+	uint32_t stack[(JSON_SAX_MAX_DEPTH + 31) / 32];
+	const char *literal;
+	int scratch_len;
+	char scratch[JSON_SAX_MAX_KEY_LEN];
+} json_sax_ctx_t;
+
+void json_sax_start(json_sax_ctx_t *ctx, json_sax_cb_t cb, void *priv);
+int json_sax_feed(json_sax_ctx_t *ctx, const char *buf, int len);
+int json_sax_end(json_sax_ctx_t *ctx);
+static inline int json_sax_get_depth(json_sax_ctx_t *ctx)
+{
+	return ctx->depth;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _JSON_SAX_H_ */
@@ -66,6 +66,29 @@ enum jsmnerr {
  * start	start position in JSON data string
  * end		end position in JSON data string
  */
+#ifdef JSMN_COMPACT
+/**
+ * Compact layout for documents shorter than 64 KB, 8 bytes per token with
+ * JSMN_NEXT_LINKS. The type shares 16 bits with the size, which limits
+ * objects and arrays to JSMN_SIZE_MAX children. Parents are not stored.
+ */
+#ifdef JSMN_PARENT_LINKS
+#error "JSMN_PARENT_LINKS is not supported with JSMN_COMPACT"
+#endif
+#include <stdint.h>
+#define JSMN_POS_UNSET 0xFFFF
+#define JSMN_SIZE_MAX 0x1FFF
+typedef struct jsmntok {
+  uint16_t start;
+  uint16_t end;
+  unsigned int type : 3;
+  unsigned int size : 13;
+#ifdef JSMN_NEXT_LINKS
+  uint16_t next; /* index of the token following this one's subtree */
+#endif
+} jsmntok_t;
+#else
+#define JSMN_POS_UNSET -1
 typedef struct jsmntok {
   jsmntype_t type;
   int start;
@@ -74,7 +97,11 @@ typedef struct jsmntok {
 #ifdef JSMN_PARENT_LINKS
   int parent;
 #endif
+#ifdef JSMN_NEXT_LINKS
+  int next; /* index of the token following this one's subtree */
+#endif
 } jsmntok_t;
+#endif
 
 /**
  * JSON parser. Contains an array of token blocks available. Also stores
@@ -84,6 +111,7 @@ typedef struct jsmn_parser {
   unsigned int pos;     /* offset in the JSON string */
   unsigned int toknext; /* next token to allocate */
   int toksuper;         /* superior token node, e.g. parent object or array */
+  int single_value;     /* stop right after the first top level value */
 } jsmn_parser;
 
 /**
@@ -95,11 +123,18 @@ JSMN_API void jsmn_init(jsmn_parser *parser);
  * Run JSON parser. It parses a JSON data string into and array of tokens, each
  * describing
  * a single JSON object.
+ *
+ * If single_value is set (after jsmn_init()), parsing starts at parser->pos and
+ * returns as soon as one complete value has been read, with parser->pos right
+ * after it. This needs tokens, as the structure is not tracked without them.
  */
 JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
                         jsmntok_t *tokens, const unsigned int num_tokens);
 
 #ifndef JSMN_HEADER
+#ifdef JSMN_FAST_SCAN
+#include <string.h>
+#endif
 /**
  * Allocates a fresh unused token from the token pool.
  */
@@ -110,14 +145,48 @@ static jsmntok_t *jsmn_alloc_token(jsmn_parser *parser, jsmntok_t *tokens,
     return NULL;
   }
   tok = &tokens[parser->toknext++];
-  tok->start = tok->end = -1;
+  tok->start = tok->end = JSMN_POS_UNSET;
   tok->size = 0;
 #ifdef JSMN_PARENT_LINKS
   tok->parent = -1;
+#endif
+#ifdef JSMN_NEXT_LINKS
+  tok->next = parser->toknext;
 #endif
   return tok;
 }
 
+#ifdef JSMN_NEXT_LINKS
+/**
+ * Extends the subtree of a key to include the value that was just completed.
+ * The value of a key is always the token right after it.
+ */
+static void jsmn_update_key_link(jsmn_parser *parser, jsmntok_t *tokens,
+                                 const int value) {
+  jsmntok_t *key;
+  if (value < 1) {
+    return;
+  }
+  key = &tokens[value - 1];
+  if (key->type != JSMN_OBJECT && key->type != JSMN_ARRAY && key->size == 1) {
+    key->next = parser->toknext;
+  }
+}
+#endif
+
+#ifdef JSMN_COMPACT
+/**
+ * Adds a child to a token, failing if it already has as many as fit.
+ */
+static int jsmn_add_child(jsmntok_t *token) {
+  if (token->size == JSMN_SIZE_MAX) {
+    return JSMN_ERROR_INVAL;
+  }
+  token->size++;
+  return 0;
+}
+#endif
+
 /**
  * Fills token type and boundaries.
  */
@@ -129,6 +198,118 @@ static void jsmn_fill_token(jsmntok_t *token, const jsmntype_t type,
   token->size = 0;
 }
 
+#ifdef JSMN_FAST_SCAN
+/**
+ * Character classes, used to avoid branching on every byte.
+ */
+#define JSMN_CC_SPACE 0x01   /* whitespace */
+#define JSMN_CC_DELIM 0x02   /* ends a primitive */
+#define JSMN_CC_INVALID 0x04 /* not allowed in a primitive */
+#ifdef JSMN_STRICT
+#define JSMN_CC_COLON 0
+#else
+#define JSMN_CC_COLON JSMN_CC_DELIM
+#endif
+
+#define S (JSMN_CC_SPACE | JSMN_CC_DELIM)
+#define D JSMN_CC_DELIM
+#define I JSMN_CC_INVALID
+#define C JSMN_CC_COLON
+static const unsigned char jsmn_char_class[256] = {
+    0, I, I, I, I, I, I, I, I, S, S, I, I, S, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    S, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, D, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, C, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, D, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, D, 0, I,
+    I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+};
+#undef S
+#undef D
+#undef I
+#undef C
+
+/**
+ * Word at a time (SWAR) helpers. JSMN_WORD_HAS_ZERO() is non zero if and only
+ * if any byte of the word is zero.
+ */
+typedef size_t jsmn_word_t;
+#define JSMN_WORD_ONES ((jsmn_word_t)-1 / 0xFF)
+#define JSMN_WORD_HIGHS (JSMN_WORD_ONES * 0x80)
+#define JSMN_WORD_HAS_ZERO(v) (((v)-JSMN_WORD_ONES) & ~(v)&JSMN_WORD_HIGHS)
+#define JSMN_WORD_HAS_BYTE(v, b) JSMN_WORD_HAS_ZERO((v) ^ (JSMN_WORD_ONES * (b)))
+
+/* p must be word aligned */
+static jsmn_word_t jsmn_load_word(const char *p) {
+  jsmn_word_t v;
+#ifdef __GNUC__
+  memcpy(&v, __builtin_assume_aligned(p, sizeof(jsmn_word_t)), sizeof(v));
+#else
+  memcpy(&v, p, sizeof(v));
+#endif
+  return v;
+}
+
+/**
+ * Returns the position of the first '"', '\\' or '\0' at or after pos, or len.
+ * Only aligned words are read, so this never reads past len.
+ */
+static unsigned int jsmn_skip_string_run(const char *js, unsigned int pos,
+                                         const size_t len) {
+  while (pos < len && ((size_t)(js + pos) % sizeof(jsmn_word_t)) != 0) {
+    if (js[pos] == '\"' || js[pos] == '\\' || js[pos] == '\0') {
+      return pos;
+    }
+    pos++;
+  }
+  while (pos + sizeof(jsmn_word_t) <= len) {
+    jsmn_word_t v = jsmn_load_word(js + pos);
+    if (JSMN_WORD_HAS_BYTE(v, '\"') | JSMN_WORD_HAS_BYTE(v, '\\') |
+        JSMN_WORD_HAS_ZERO(v)) {
+      break;
+    }
+    pos += sizeof(jsmn_word_t);
+  }
+  while (pos < len && js[pos] != '\"' && js[pos] != '\\' && js[pos] != '\0') {
+    pos++;
+  }
+  return pos;
+}
+
+/**
+ * Returns the position of the first non whitespace byte at or after pos, or
+ * len. Runs of spaces (indentation) are skipped a word at a time.
+ */
+static unsigned int jsmn_skip_space(const char *js, unsigned int pos,
+                                    const size_t len) {
+  for (;;) {
+    while (pos < len && ((size_t)(js + pos) % sizeof(jsmn_word_t)) != 0) {
+      if (!(jsmn_char_class[(unsigned char)js[pos]] & JSMN_CC_SPACE)) {
+        return pos;
+      }
+      pos++;
+    }
+    while (pos + sizeof(jsmn_word_t) <= len &&
+           jsmn_load_word(js + pos) == JSMN_WORD_ONES * ' ') {
+      pos += sizeof(jsmn_word_t);
+    }
+    if (pos >= len || !(jsmn_char_class[(unsigned char)js[pos]] & JSMN_CC_SPACE)) {
+      return pos;
+    }
+    pos++;
+  }
+}
+#endif /* JSMN_FAST_SCAN */
+
 /**
  * Fills next available token with JSON primitive.
  */
@@ -141,6 +322,17 @@ static int jsmn_parse_primitive(jsmn_parser *parser, const char *js,
   start = parser->pos;
 
   for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
+#ifdef JSMN_FAST_SCAN
+    const unsigned char cls = jsmn_char_class[(unsigned char)js[parser->pos]];
+    if (cls & JSMN_CC_DELIM) {
+      goto found;
+    }
+    if (cls & JSMN_CC_INVALID) {
+      parser->pos = start;
+      return JSMN_ERROR_INVAL;
+    }
+    continue;
+#endif
     switch (js[parser->pos]) {
 #ifndef JSMN_STRICT
     /* In strict mode primitive must be followed by "," or "}" or "]" */
@@ -201,7 +393,15 @@ static int jsmn_parse_string(jsmn_parser *parser, const char *js,
 
   /* Skip starting quote */
   for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
-    char c = js[parser->pos];
+    char c;
+#ifdef JSMN_FAST_SCAN
+    /* Jump over the bytes which need no attention */
+    parser->pos = jsmn_skip_string_run(js, parser->pos, len);
+    if (parser->pos >= len || js[parser->pos] == '\0') {
+      break;
+    }
+#endif
+    c = js[parser->pos];
 
     /* Quote: end of string */
     if (c == '\"') {
@@ -272,6 +472,13 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
   jsmntok_t *token;
   int count = parser->toknext;
 
+#ifdef JSMN_COMPACT
+  /* Every position, including the end, must fit below JSMN_POS_UNSET */
+  if (len >= JSMN_POS_UNSET) {
+    return JSMN_ERROR_INVAL;
+  }
+#endif
+
   for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
     char c;
     jsmntype_t type;
@@ -296,7 +503,13 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
           return JSMN_ERROR_INVAL;
         }
 #endif
+#ifdef JSMN_COMPACT
+        if (jsmn_add_child(t) < 0) {
+          return JSMN_ERROR_INVAL;
+        }
+#else
         t->size++;
+#endif
 #ifdef JSMN_PARENT_LINKS
         token->parent = parser->toksuper;
 #endif
@@ -317,12 +530,16 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
       }
       token = &tokens[parser->toknext - 1];
       for (;;) {
-        if (token->start != -1 && token->end == -1) {
+        if (token->start != JSMN_POS_UNSET && token->end == JSMN_POS_UNSET) {
           if (token->type != type) {
             return JSMN_ERROR_INVAL;
           }
           token->end = parser->pos + 1;
           parser->toksuper = token->parent;
+#ifdef JSMN_NEXT_LINKS
+          token->next = parser->toknext;
+          jsmn_update_key_link(parser, tokens, (int)(token - tokens));
+#endif
           break;
         }
         if (token->parent == -1) {
@@ -336,12 +553,16 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
 #else
       for (i = parser->toknext - 1; i >= 0; i--) {
         token = &tokens[i];
-        if (token->start != -1 && token->end == -1) {
+        if (token->start != JSMN_POS_UNSET && token->end == JSMN_POS_UNSET) {
           if (token->type != type) {
             return JSMN_ERROR_INVAL;
           }
           parser->toksuper = -1;
           token->end = parser->pos + 1;
+#ifdef JSMN_NEXT_LINKS
+          token->next = parser->toknext;
+          jsmn_update_key_link(parser, tokens, i);
+#endif
           break;
         }
       }
@@ -351,12 +572,16 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
       }
       for (; i >= 0; i--) {
         token = &tokens[i];
-        if (token->start != -1 && token->end == -1) {
+        if (token->start != JSMN_POS_UNSET && token->end == JSMN_POS_UNSET) {
           parser->toksuper = i;
           break;
         }
       }
 #endif
+      if (parser->single_value && parser->toksuper == -1) {
+        parser->pos++;
+        return count;
+      }
       break;
     case '\"':
       r = jsmn_parse_string(parser, js, len, tokens, num_tokens);
@@ -365,13 +590,30 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
       }
       count++;
       if (parser->toksuper != -1 && tokens != NULL) {
+#ifdef JSMN_COMPACT
+        if (jsmn_add_child(&tokens[parser->toksuper]) < 0) {
+          return JSMN_ERROR_INVAL;
+        }
+#else
         tokens[parser->toksuper].size++;
+#endif
+#ifdef JSMN_NEXT_LINKS
+        jsmn_update_key_link(parser, tokens, parser->toknext - 1);
+#endif
+      }
+      if (parser->single_value && parser->toksuper == -1 && tokens != NULL) {
+        parser->pos++;
+        return count;
       }
       break;
     case '\t':
     case '\r':
     case '\n':
     case ' ':
+#ifdef JSMN_FAST_SCAN
+      /* Leave pos at the last whitespace byte, the loop moves past it */
+      parser->pos = jsmn_skip_space(js, parser->pos, len) - 1;
+#endif
       break;
     case ':':
       parser->toksuper = parser->toknext - 1;
@@ -385,7 +627,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
 #else
         for (i = parser->toknext - 1; i >= 0; i--) {
           if (tokens[i].type == JSMN_ARRAY || tokens[i].type == JSMN_OBJECT) {
-            if (tokens[i].start != -1 && tokens[i].end == -1) {
+            if (tokens[i].start != JSMN_POS_UNSET && tokens[i].end == JSMN_POS_UNSET) {
               parser->toksuper = i;
               break;
             }
@@ -428,7 +670,20 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
       }
       count++;
       if (parser->toksuper != -1 && tokens != NULL) {
+#ifdef JSMN_COMPACT
+        if (jsmn_add_child(&tokens[parser->toksuper]) < 0) {
+          return JSMN_ERROR_INVAL;
+        }
+#else
         tokens[parser->toksuper].size++;
+#endif
+#ifdef JSMN_NEXT_LINKS
+        jsmn_update_key_link(parser, tokens, parser->toknext - 1);
+#endif
+      }
+      if (parser->single_value && parser->toksuper == -1 && tokens != NULL) {
+        parser->pos++;
+        return count;
       }
       break;
 
@@ -443,7 +698,7 @@ JSMN_API int jsmn_parse(jsmn_parser *parser, const char *js, const size_t len,
   if (tokens != NULL) {
     for (i = parser->toknext - 1; i >= 0; i--) {
       /* Unmatched opened object or array */
-      if (tokens[i].start != -1 && tokens[i].end == -1) {
+      if (tokens[i].start != JSMN_POS_UNSET && tokens[i].end == JSMN_POS_UNSET) {
         return JSMN_ERROR_PART;
       }
     }
@@ -460,6 +715,7 @@ JSMN_API void jsmn_init(jsmn_parser *parser) {
   parser->pos = 0;
   parser->toknext = 0;
   parser->toksuper = -1;
+  parser->single_value = 0;
 }
 
 #endif /* JSMN_HEADER */
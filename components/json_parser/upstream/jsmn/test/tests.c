@@ -336,6 +336,50 @@ int test_object_key(void) {
   return 0;
 }
 
+int test_single_value(void) {
+  int r;
+  jsmn_parser p;
+  jsmntok_t tokens[10];
+  const char *js = "{\"a\": [1, {\"b\": \"c\"}], \"d\": true}";
+
+  jsmn_init(&p);
+  p.single_value = 1;
+  p.pos = 6;
+  r = jsmn_parse(&p, js, strlen(js), tokens, 10);
+  check(r == 5);
+  check(p.pos == 21);
+  check(tokeq(js, tokens, 5, JSMN_ARRAY, 6, 21, 2, JSMN_PRIMITIVE, "1",
+              JSMN_OBJECT, 10, 20, 1, JSMN_STRING, "b", 1, JSMN_STRING, "c",
+              0));
+
+  jsmn_init(&p);
+  p.single_value = 1;
+  p.pos = 23;
+  r = jsmn_parse(&p, js, strlen(js), tokens, 10);
+  check(r == 1);
+  check(p.pos == 26);
+  check(tokeq(js, tokens, 1, JSMN_STRING, "d", 0));
+
+  jsmn_init(&p);
+  p.single_value = 1;
+  p.pos = 28;
+  r = jsmn_parse(&p, js, strlen(js), tokens, 10);
+  check(r == 1);
+  check(p.pos == 32);
+  check(tokeq(js, tokens, 1, JSMN_PRIMITIVE, "true"));
+
+  /* Out of tokens in the middle of the value, parsing resumes from there */
+  jsmn_init(&p);
+  p.single_value = 1;
+  p.pos = 6;
+  r = jsmn_parse(&p, js, strlen(js), tokens, 2);
+  check(r == JSMN_ERROR_NOMEM);
+  r = jsmn_parse(&p, js, strlen(js), tokens, 10);
+  check(r == 5);
+  check(p.pos == 21);
+  return 0;
+}
+
 int main(void) {
   test(test_empty, "test for a empty JSON objects/arrays");
   test(test_object, "test for a JSON objects");
@@ -354,6 +398,7 @@ int main(void) {
   test(test_nonstrict, "test for non-strict mode");
   test(test_unmatched_brackets, "test for unmatched brackets");
   test(test_object_key, "test for key type");
+  test(test_single_value, "test for parsing a single value");
   printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
   return (test_failed > 0);
 }
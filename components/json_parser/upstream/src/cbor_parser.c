@@ -0,0 +1,607 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <string.h>
+#include <cbor_parser.h>
+
+/* Major types */
+#define CBOR_UINT	0
+#define CBOR_NEGINT	1
+#define CBOR_BYTES	2
+#define CBOR_TEXT	3
+#define CBOR_ARRAY	4
+#define CBOR_MAP	5
+#define CBOR_TAG	6
+#define CBOR_SIMPLE	7
+
+#define CBOR_INDEFINITE	31
+#define CBOR_FALSE	0xf4
+#define CBOR_TRUE	0xf5
+#define CBOR_BREAK	0xff
+
+typedef struct {
+	uint8_t major;
+	/* Additional information, i.e. the low 5 bits of the initial byte */
+	uint8_t info;
+	/* Value, length or number of elements (pairs for maps) */
+	uint64_t arg;
+} cbor_head_t;
+
+/* Decodes the initial byte and argument of the item at p, returning the
+ * position right after them
+ */
+static inline const uint8_t *cbor_read_head(const uint8_t *p, const uint8_t *end, cbor_head_t *head)
+{
+	if (p >= end)
+		return NULL;
+	head->major = *p >> 5;
+	head->info = *p & 0x1f;
+	p++;
+	switch (head->info) {
+	case 24:
+		if (end - p < 1)
+			return NULL;
+		head->arg = p[0];
+		return p + 1;
+	case 25:
+		if (end - p < 2)
+			return NULL;
+		head->arg = (uint32_t)p[0] << 8 | p[1];
+		return p + 2;
+	case 26:
+		if (end - p < 4)
+			return NULL;
+		head->arg = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+		return p + 4;
+	case 27:
+		if (end - p < 8)
+			return NULL;
+		head->arg = (uint64_t)p[0] << 56 | (uint64_t)p[1] << 48 | (uint64_t)p[2] << 40 | (uint64_t)p[3] << 32
+				| (uint32_t)p[4] << 24 | (uint32_t)p[5] << 16 | (uint32_t)p[6] << 8 | p[7];
+		return p + 8;
+	case 28:
+	case 29:
+	case 30:
+		return NULL;
+	case CBOR_INDEFINITE:
+		/* Only strings, arrays, maps and the break can be indefinite */
+		if (head->major < CBOR_BYTES || head->major == CBOR_TAG)
+			return NULL;
+		head->arg = 0;
+		return p;
+	default:
+		head->arg = head->info;
+		return p;
+	}
+}
+
+static const uint8_t *cbor_skip(const uint8_t *p, const uint8_t *end, int depth);
+
+/* Skips an element of an array or map. Numbers are just a head, so those (the
+ * bulk of telemetry) are stepped over without a call
+ */
+static inline const uint8_t *cbor_skip_elem(const uint8_t *p, const uint8_t *end, int depth)
+{
+	cbor_head_t head;
+	if (p < end && (*p < 0x40 || (*p >= 0xf9 && *p <= 0xfb)))
+		return cbor_read_head(p, end, &head);
+	return cbor_skip(p, end, depth);
+}
+
+/* Returns the position after the item at p, or NULL if it is not well formed */
+static const uint8_t *cbor_skip(const uint8_t *p, const uint8_t *end, int depth)
+{
+	cbor_head_t head;
+	p = cbor_read_head(p, end, &head);
+	if (!p)
+		return NULL;
+	switch (head.major) {
+	case CBOR_UINT:
+	case CBOR_NEGINT:
+		return p;
+	case CBOR_BYTES:
+	case CBOR_TEXT:
+		if (head.info != CBOR_INDEFINITE) {
+			if (head.arg > (uint64_t)(end - p))
+				return NULL;
+			return p + head.arg;
+		}
+		/* Definite length chunks of the same type, up to a break */
+		while (p < end && *p != CBOR_BREAK) {
+			cbor_head_t chunk;
+			p = cbor_read_head(p, end, &chunk);
+			if (!p || chunk.major != head.major || chunk.info == CBOR_INDEFINITE
+					|| chunk.arg > (uint64_t)(end - p))
+				return NULL;
+			p += chunk.arg;
+		}
+		return p < end ? p + 1 : NULL;
+	case CBOR_ARRAY:
+	case CBOR_MAP: {
+		int per_elem = head.major == CBOR_MAP ? 2 : 1;
+		if (depth >= CBOR_PARSER_MAX_DEPTH)
+			return NULL;
+		if (head.info != CBOR_INDEFINITE) {
+			/* Every item takes at least a byte */
+			if (head.arg > (uint64_t)(end - p))
+				return NULL;
+			for (uint64_t i = 0; i < head.arg * per_elem && p; i++)
+				p = cbor_skip_elem(p, end, depth + 1);
+			return p;
+		}
+		while (p < end && *p != CBOR_BREAK) {
+			for (int i = 0; i < per_elem && p; i++)
+				p = (p < end && *p != CBOR_BREAK) ? cbor_skip_elem(p, end, depth + 1) : NULL;
+			if (!p)
+				return NULL;
+		}
+		return p < end ? p + 1 : NULL;
+	}
+	case CBOR_TAG:
+		if (depth >= CBOR_PARSER_MAX_DEPTH)
+			return NULL;
+		return cbor_skip(p, end, depth + 1);
+	default:
+		/* Simple values and floats. A break is only valid where checked for above */
+		if (head.info == CBOR_INDEFINITE || (head.info == 24 && head.arg < 32))
+			return NULL;
+		return p;
+	}
+}
+
+/* Iteration over the elements of an array, or the keys and values of a map */
+typedef struct {
+	const uint8_t *p;
+	const uint8_t *end;
+	/* Items left, -1 for indefinite length */
+	int64_t remaining;
+} cbor_iter_t;
+
+static int cbor_iter_begin(cbor_parse_ctx_t *ctx, uint8_t major, cbor_iter_t *it)
+{
+	cbor_head_t head;
+	it->end = ctx->buf + ctx->len;
+	it->p = cbor_read_head(ctx->cur, it->end, &head);
+	if (!it->p || head.major != major)
+		return -OS_FAIL;
+	it->remaining = head.info == CBOR_INDEFINITE ? -1 : (int64_t)head.arg * (major == CBOR_MAP ? 2 : 1);
+	return OS_SUCCESS;
+}
+
+static bool cbor_iter_done(cbor_iter_t *it)
+{
+	return it->remaining == 0 || (it->remaining < 0 && *it->p == CBOR_BREAK);
+}
+
+/* The document was validated by cbor_parse_start(), so skipping cannot fail here */
+static void cbor_iter_next(cbor_iter_t *it)
+{
+	it->p = cbor_skip_elem(it->p, it->end, 0);
+	if (it->remaining > 0)
+		it->remaining--;
+}
+
+/* Returns the value for the key name in the current map */
+static const uint8_t *cbor_obj_search(cbor_parse_ctx_t *ctx, const char *name)
+{
+	cbor_iter_t it;
+	if (cbor_iter_begin(ctx, CBOR_MAP, &it) != OS_SUCCESS)
+		return NULL;
+	size_t name_len = strlen(name);
+	while (!cbor_iter_done(&it)) {
+		cbor_head_t key;
+		const uint8_t *key_str = cbor_read_head(it.p, it.end, &key);
+		bool match = key.major == CBOR_TEXT && key.info != CBOR_INDEFINITE
+				&& key.arg == name_len && memcmp(key_str, name, name_len) == 0;
+		cbor_iter_next(&it);
+		if (match)
+			return it.p;
+		cbor_iter_next(&it);
+	}
+	return NULL;
+}
+
+/* Returns the element at index in the current array. The last element found is
+ * remembered, so that going through an array by increasing index is linear.
+ */
+static const uint8_t *cbor_arr_search(cbor_parse_ctx_t *ctx, uint32_t index)
+{
+	cbor_iter_t it;
+	uint32_t i = 0;
+	if (cbor_iter_begin(ctx, CBOR_ARRAY, &it) != OS_SUCCESS)
+		return NULL;
+	if (ctx->elem && index >= ctx->elem_index) {
+		it.p = ctx->elem;
+		i = ctx->elem_index;
+		if (it.remaining > 0)
+			it.remaining -= i;
+	}
+	for (; !cbor_iter_done(&it); i++) {
+		if (i == index) {
+			ctx->elem = it.p;
+			ctx->elem_index = i;
+			return it.p;
+		}
+		cbor_iter_next(&it);
+	}
+	return NULL;
+}
+
+static int cbor_enter(cbor_parse_ctx_t *ctx, const uint8_t *item, uint8_t major)
+{
+	if (!item || (*item >> 5) != major || ctx->depth == CBOR_PARSER_MAX_DEPTH)
+		return -OS_FAIL;
+	ctx->stack[ctx->depth++] = ctx->cur;
+	ctx->cur = item;
+	ctx->elem = NULL;
+	return OS_SUCCESS;
+}
+
+static int cbor_leave(cbor_parse_ctx_t *ctx)
+{
+	if (!ctx->depth)
+		return -OS_FAIL;
+	ctx->cur = ctx->stack[--ctx->depth];
+	ctx->elem = NULL;
+	return OS_SUCCESS;
+}
+
+static int cbor_enter_array(cbor_parse_ctx_t *ctx, const uint8_t *item, int *num_elem)
+{
+	if (cbor_enter(ctx, item, CBOR_ARRAY) != OS_SUCCESS)
+		return -OS_FAIL;
+	cbor_iter_t it;
+	if (cbor_iter_begin(ctx, CBOR_ARRAY, &it) != OS_SUCCESS) {
+		cbor_leave(ctx);
+		return -OS_FAIL;
+	}
+	if (it.remaining >= 0) {
+		*num_elem = it.remaining;
+	} else {
+		for (*num_elem = 0; !cbor_iter_done(&it); cbor_iter_next(&it))
+			(*num_elem)++;
+	}
+	return OS_SUCCESS;
+}
+
+static int cbor_item_to_bool(const uint8_t *item, bool *val)
+{
+	if (!item || (*item != CBOR_TRUE && *item != CBOR_FALSE))
+		return -OS_FAIL;
+	*val = *item == CBOR_TRUE;
+	return OS_SUCCESS;
+}
+
+static inline int cbor_head_to_int64(const cbor_head_t *head, int64_t *val)
+{
+	if ((head->major != CBOR_UINT && head->major != CBOR_NEGINT) || head->arg > INT64_MAX)
+		return -OS_FAIL;
+	*val = head->major == CBOR_UINT ? (int64_t)head->arg : -1 - (int64_t)head->arg;
+	return OS_SUCCESS;
+}
+
+static inline int cbor_head_to_int(const cbor_head_t *head, int *val)
+{
+	int64_t val64;
+	if (cbor_head_to_int64(head, &val64) != OS_SUCCESS || val64 < INT32_MIN || val64 > INT32_MAX)
+		return -OS_FAIL;
+	*val = val64;
+	return OS_SUCCESS;
+}
+
+static inline float cbor_half_to_float(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exp = (half >> 10) & 0x1f;
+	uint32_t mant = half & 0x3ff;
+	uint32_t bits;
+	float val;
+	if (exp == 0) {
+		/* Zero or subnormal, i.e. mant * 2^-24, which a float holds exactly */
+		val = mant / 16777216.0f;
+		return sign ? -val : val;
+	}
+	if (exp == 0x1f)
+		bits = sign | 0x7f800000 | mant << 13;
+	else
+		bits = sign | (exp - 15 + 127) << 23 | mant << 13;
+	memcpy(&val, &bits, sizeof(val));
+	return val;
+}
+
+static inline int cbor_head_to_float(const cbor_head_t *head, float *val)
+{
+	if (head->major == CBOR_UINT) {
+		*val = head->arg;
+		return OS_SUCCESS;
+	}
+	if (head->major == CBOR_NEGINT) {
+		/* Converting -1 - arg in one go, so that it is rounded just once */
+		*val = head->arg <= INT64_MAX ? (float)(-1 - (int64_t)head->arg) : -1.0f - (float)head->arg;
+		return OS_SUCCESS;
+	}
+	if (head->major != CBOR_SIMPLE)
+		return -OS_FAIL;
+	if (head->info == 25) {
+		*val = cbor_half_to_float(head->arg);
+	} else if (head->info == 26) {
+		uint32_t bits = head->arg;
+		memcpy(val, &bits, sizeof(*val));
+	} else if (head->info == 27) {
+		double dval;
+		memcpy(&dval, &head->arg, sizeof(dval));
+		*val = dval;
+	} else {
+		return -OS_FAIL;
+	}
+	return OS_SUCCESS;
+}
+
+/* Numbers are just a head, so the value is known from that */
+static int cbor_item_to_int64(cbor_parse_ctx_t *ctx, const uint8_t *item, int64_t *val)
+{
+	cbor_head_t head;
+	if (!item || !cbor_read_head(item, ctx->buf + ctx->len, &head))
+		return -OS_FAIL;
+	return cbor_head_to_int64(&head, val);
+}
+
+static int cbor_item_to_int(cbor_parse_ctx_t *ctx, const uint8_t *item, int *val)
+{
+	cbor_head_t head;
+	if (!item || !cbor_read_head(item, ctx->buf + ctx->len, &head))
+		return -OS_FAIL;
+	return cbor_head_to_int(&head, val);
+}
+
+static int cbor_item_to_float(cbor_parse_ctx_t *ctx, const uint8_t *item, float *val)
+{
+	cbor_head_t head;
+	if (!item || !cbor_read_head(item, ctx->buf + ctx->len, &head))
+		return -OS_FAIL;
+	return cbor_head_to_float(&head, val);
+}
+
+/* Gets the length of a text string and, if val is not NULL, copies it out NULL
+ * terminated. Indefinite length strings are joined.
+ */
+static int cbor_item_to_string(cbor_parse_ctx_t *ctx, const uint8_t *item, char *val, int size, int *len)
+{
+	const uint8_t *end = ctx->buf + ctx->len;
+	cbor_head_t head;
+	const uint8_t *p;
+	if (!item || !(p = cbor_read_head(item, end, &head)) || head.major != CBOR_TEXT)
+		return -OS_FAIL;
+	*len = 0;
+	bool indefinite = head.info == CBOR_INDEFINITE;
+	while (!indefinite || *p != CBOR_BREAK) {
+		if (indefinite)
+			p = cbor_read_head(p, end, &head);
+		if (val) {
+			if (*len + head.arg >= (uint64_t)size)
+				return -OS_FAIL;
+			memcpy(val + *len, p, head.arg);
+		}
+		*len += head.arg;
+		p += head.arg;
+		if (!indefinite)
+			break;
+	}
+	if (val)
+		val[*len] = '\0';
+	return OS_SUCCESS;
+}
+
+static int cbor_item_to_string_val(cbor_parse_ctx_t *ctx, const uint8_t *item, char *val, int size)
+{
+	int len;
+	return cbor_item_to_string(ctx, item, val, size, &len);
+}
+
+static int cbor_item_to_strlen(cbor_parse_ctx_t *ctx, const uint8_t *item, int *strlen)
+{
+	return cbor_item_to_string(ctx, item, NULL, 0, strlen);
+}
+
+typedef enum {
+	CBOR_NUM_INT,
+	CBOR_NUM_INT64,
+	CBOR_NUM_FLOAT,
+} cbor_num_type_t;
+
+/* Decodes a whole array of numbers. As every element is just a head, they are
+ * converted while stepping over them, without skipping each one separately.
+ */
+static int cbor_item_to_num_array(cbor_parse_ctx_t *ctx, const uint8_t *item, cbor_num_type_t type,
+		void *val, int max_elem, int *num_elem)
+{
+	const uint8_t *end = ctx->buf + ctx->len;
+	cbor_head_t head;
+	const uint8_t *p;
+	if (!item || !(p = cbor_read_head(item, end, &head)) || head.major != CBOR_ARRAY)
+		return -OS_FAIL;
+	bool indefinite = head.info == CBOR_INDEFINITE;
+	uint64_t count = head.arg;
+	int i;
+	for (i = 0; indefinite ? *p != CBOR_BREAK : (uint64_t)i < count; i++) {
+		int ret;
+		if (i == max_elem)
+			return -OS_FAIL;
+		p = cbor_read_head(p, end, &head);
+		if (type == CBOR_NUM_INT) {
+			ret = cbor_head_to_int(&head, (int *)val + i);
+		} else if (type == CBOR_NUM_INT64) {
+			ret = cbor_head_to_int64(&head, (int64_t *)val + i);
+		} else {
+			ret = cbor_head_to_float(&head, (float *)val + i);
+		}
+		if (ret != OS_SUCCESS)
+			return -OS_FAIL;
+	}
+	*num_elem = i;
+	return OS_SUCCESS;
+}
+
+int cbor_parse_start(cbor_parse_ctx_t *ctx, const uint8_t *buf, int len)
+{
+	memset(ctx, 0, sizeof(cbor_parse_ctx_t));
+	if (!buf || len <= 0)
+		return -OS_FAIL;
+	uint8_t major = buf[0] >> 5;
+	if ((major != CBOR_MAP && major != CBOR_ARRAY) || cbor_skip(buf, buf + len, 0) != buf + len)
+		return -OS_FAIL;
+	ctx->buf = buf;
+	ctx->len = len;
+	ctx->cur = buf;
+	return OS_SUCCESS;
+}
+
+int cbor_parse_end(cbor_parse_ctx_t *ctx)
+{
+	memset(ctx, 0, sizeof(cbor_parse_ctx_t));
+	return OS_SUCCESS;
+}
+
+int cbor_obj_get_array(cbor_parse_ctx_t *ctx, char *name, int *num_elem)
+{
+	return cbor_enter_array(ctx, cbor_obj_search(ctx, name), num_elem);
+}
+
+int cbor_obj_leave_array(cbor_parse_ctx_t *ctx)
+{
+	return cbor_leave(ctx);
+}
+
+int cbor_obj_get_object(cbor_parse_ctx_t *ctx, char *name)
+{
+	return cbor_enter(ctx, cbor_obj_search(ctx, name), CBOR_MAP);
+}
+
+int cbor_obj_leave_object(cbor_parse_ctx_t *ctx)
+{
+	return cbor_leave(ctx);
+}
+
+int cbor_obj_get_bool(cbor_parse_ctx_t *ctx, char *name, bool *val)
+{
+	return cbor_item_to_bool(cbor_obj_search(ctx, name), val);
+}
+
+int cbor_obj_get_int(cbor_parse_ctx_t *ctx, char *name, int *val)
+{
+	return cbor_item_to_int(ctx, cbor_obj_search(ctx, name), val);
+}
+
+int cbor_obj_get_int64(cbor_parse_ctx_t *ctx, char *name, int64_t *val)
+{
+	return cbor_item_to_int64(ctx, cbor_obj_search(ctx, name), val);
+}
+
+int cbor_obj_get_float(cbor_parse_ctx_t *ctx, char *name, float *val)
+{
+	return cbor_item_to_float(ctx, cbor_obj_search(ctx, name), val);
+}
+
+int cbor_obj_get_string(cbor_parse_ctx_t *ctx, char *name, char *val, int size)
+{
+	return cbor_item_to_string_val(ctx, cbor_obj_search(ctx, name), val, size);
+}
+
+int cbor_obj_get_strlen(cbor_parse_ctx_t *ctx, char *name, int *strlen)
+{
+	return cbor_item_to_strlen(ctx, cbor_obj_search(ctx, name), strlen);
+}
+
+int cbor_obj_get_int_array(cbor_parse_ctx_t *ctx, char *name, int *val, int max_elem, int *num_elem)
+{
+	return cbor_item_to_num_array(ctx, cbor_obj_search(ctx, name), CBOR_NUM_INT, val, max_elem, num_elem);
+}
+
+int cbor_obj_get_int64_array(cbor_parse_ctx_t *ctx, char *name, int64_t *val, int max_elem, int *num_elem)
+{
+	return cbor_item_to_num_array(ctx, cbor_obj_search(ctx, name), CBOR_NUM_INT64, val, max_elem, num_elem);
+}
+
+int cbor_obj_get_float_array(cbor_parse_ctx_t *ctx, char *name, float *val, int max_elem, int *num_elem)
+{
+	return cbor_item_to_num_array(ctx, cbor_obj_search(ctx, name), CBOR_NUM_FLOAT, val, max_elem, num_elem);
+}
+
+int cbor_arr_get_array(cbor_parse_ctx_t *ctx, uint32_t index)
+{
+	int num_elem;
+	return cbor_enter_array(ctx, cbor_arr_search(ctx, index), &num_elem);
+}
+
+int cbor_arr_leave_array(cbor_parse_ctx_t *ctx)
+{
+	return cbor_leave(ctx);
+}
+
+int cbor_arr_get_object(cbor_parse_ctx_t *ctx, uint32_t index)
+{
+	return cbor_enter(ctx, cbor_arr_search(ctx, index), CBOR_MAP);
+}
+
+int cbor_arr_leave_object(cbor_parse_ctx_t *ctx)
+{
+	return cbor_leave(ctx);
+}
+
+int cbor_arr_get_bool(cbor_parse_ctx_t *ctx, uint32_t index, bool *val)
+{
+	return cbor_item_to_bool(cbor_arr_search(ctx, index), val);
+}
+
+int cbor_arr_get_int(cbor_parse_ctx_t *ctx, uint32_t index, int *val)
+{
+	return cbor_item_to_int(ctx, cbor_arr_search(ctx, index), val);
+}
+
+int cbor_arr_get_int64(cbor_parse_ctx_t *ctx, uint32_t index, int64_t *val)
+{
+	return cbor_item_to_int64(ctx, cbor_arr_search(ctx, index), val);
+}
+
+int cbor_arr_get_float(cbor_parse_ctx_t *ctx, uint32_t index, float *val)
+{
+	return cbor_item_to_float(ctx, cbor_arr_search(ctx, index), val);
+}
+
+int cbor_arr_get_string(cbor_parse_ctx_t *ctx, uint32_t index, char *val, int size)
+{
+	return cbor_item_to_string_val(ctx, cbor_arr_search(ctx, index), val, size);
+}
+
+int cbor_arr_get_strlen(cbor_parse_ctx_t *ctx, uint32_t index, int *strlen)
+{
+	return cbor_item_to_strlen(ctx, cbor_arr_search(ctx, index), strlen);
+}
+
+int cbor_arr_get_int_array(cbor_parse_ctx_t *ctx, uint32_t index, int *val, int max_elem, int *num_elem)
+{
+	return cbor_item_to_num_array(ctx, cbor_arr_search(ctx, index), CBOR_NUM_INT, val, max_elem, num_elem);
+}
+
+int cbor_arr_get_int64_array(cbor_parse_ctx_t *ctx, uint32_t index, int64_t *val, int max_elem, int *num_elem)
+{
+	return cbor_item_to_num_array(ctx, cbor_arr_search(ctx, index), CBOR_NUM_INT64, val, max_elem, num_elem);
+}
+
+int cbor_arr_get_float_array(cbor_parse_ctx_t *ctx, uint32_t index, float *val, int max_elem, int *num_elem)
+{
+	return cbor_item_to_num_array(ctx, cbor_arr_search(ctx, index), CBOR_NUM_FLOAT, val, max_elem, num_elem);
+}
@@ -0,0 +1,143 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <json_batch.h>
+
+/* Documents taken by a worker at a time, to keep contention on the counter low */
+#ifndef JSON_BATCH_CHUNK
+#define JSON_BATCH_CHUNK	16
+#endif
+
+#ifndef JSON_BATCH_MAX_THREADS
+#define JSON_BATCH_MAX_THREADS	64
+#endif
+
+typedef struct {
+	const json_batch_doc_t *docs;
+	int num_docs;
+	json_batch_cb_t cb;
+	void *priv;
+	int next;
+	int failed;
+} json_batch_t;
+
+static void *json_batch_worker(void *arg)
+{
+	json_batch_t *batch = (json_batch_t *)arg;
+	json_tok_arena_t arena;
+	int failed = 0;
+
+	json_tok_arena_init(&arena, NULL, 0);
+	while (1) {
+		int start = __atomic_fetch_add(&batch->next, JSON_BATCH_CHUNK, __ATOMIC_RELAXED);
+		if (start >= batch->num_docs)
+			break;
+		int end = start + JSON_BATCH_CHUNK;
+		if (end > batch->num_docs)
+			end = batch->num_docs;
+		for (int i = start; i < end; i++) {
+			jparse_ctx_t jctx;
+			if (json_parse_start_arena(&jctx, &arena, batch->docs[i].js, batch->docs[i].len) != OS_SUCCESS) {
+				batch->cb(NULL, i, batch->priv);
+				failed++;
+				continue;
+			}
+			if (batch->cb(&jctx, i, batch->priv) != OS_SUCCESS)
+				failed++;
+			json_parse_end(&jctx);
+		}
+	}
+	json_tok_arena_free(&arena);
+	if (failed)
+		__atomic_fetch_add(&batch->failed, failed, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+int json_batch_parse(const json_batch_doc_t *docs, int num_docs, int num_threads,
+		json_batch_cb_t cb, void *priv)
+{
+	pthread_t threads[JSON_BATCH_MAX_THREADS];
+	json_batch_t batch = {
+		.docs = docs,
+		.num_docs = num_docs,
+		.cb = cb,
+		.priv = priv,
+	};
+	int i, started = 0;
+
+	if (!cb || (num_docs < 0))
+		return -OS_FAIL;
+	if (num_threads <= 0)
+		num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_threads > JSON_BATCH_MAX_THREADS)
+		num_threads = JSON_BATCH_MAX_THREADS;
+	/* No point in threads which would not get a single chunk */
+	if (num_threads > (num_docs + JSON_BATCH_CHUNK - 1) / JSON_BATCH_CHUNK)
+		num_threads = (num_docs + JSON_BATCH_CHUNK - 1) / JSON_BATCH_CHUNK;
+
+	/* The calling thread is one of the workers */
+	for (i = 1; i < num_threads; i++) {
+		if (pthread_create(&threads[i], NULL, json_batch_worker, &batch) != 0)
+			break;
+		started++;
+	}
+	json_batch_worker(&batch);
+	for (i = 1; i <= started; i++)
+		pthread_join(threads[i], NULL);
+	return batch.failed ? -OS_FAIL : OS_SUCCESS;
+}
+
+int json_batch_parse_lines(char *buf, int len, int num_threads, json_batch_cb_t cb,
+		void *priv, int *num_docs)
+{
+	int count = 0, size = 64, pos = 0;
+	json_batch_doc_t *docs = malloc(size * sizeof(json_batch_doc_t));
+	if (!docs)
+		return -OS_FAIL;
+
+	while (pos < len) {
+		char *nl = memchr(buf + pos, '\n', len - pos);
+		int end = nl ? (nl - buf) : len;
+		int line_end = end;
+		if ((line_end > pos) && (buf[line_end - 1] == '\r'))
+			line_end--;
+		if (line_end > pos) {
+			if (count == size) {
+				json_batch_doc_t *new_docs = realloc(docs, 2 * size * sizeof(json_batch_doc_t));
+				if (!new_docs) {
+					free(docs);
+					return -OS_FAIL;
+				}
+				docs = new_docs;
+				size *= 2;
+			}
+			docs[count].js = buf + pos;
+			docs[count].len = line_end - pos;
+			count++;
+		}
+		pos = end + 1;
+	}
+	int ret = json_batch_parse(docs, count, num_threads, cb, priv);
+	free(docs);
+	if ((ret == OS_SUCCESS) && num_docs)
+		*num_docs = count;
+	return ret;
+}
@@ -17,28 +17,98 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef JSON_PARSER_COMPACT_TOKENS
+#define JSMN_COMPACT
+#else
 #define JSMN_PARENT_LINKS
+#endif
+#define JSMN_NEXT_LINKS
+#define JSMN_FAST_SCAN
 #define JSMN_STRICT
 #define JSMN_STATIC
 #include <jsmn/jsmn.h>
 #include <json_parser.h>
 
+#ifndef JSON_TOK_ARENA_MIN_TOKENS
+#define JSON_TOK_ARENA_MIN_TOKENS	16
+#endif
+
+#ifndef JSON_PARSE_LAZY_MAX_KEYS
+#define JSON_PARSE_LAZY_MAX_KEYS	8
+#endif
+
+#ifndef JSON_OBJ_INDEX_MIN_KEYS
+#define JSON_OBJ_INDEX_MIN_KEYS	8
+#endif
+
+/* Key table of one object. The tables of a document are chained off its context */
+struct json_obj_index {
+	json_obj_index_t *next;
+	/* Index of the object token */
+	int obj;
+	/* Number of slots. Always a power of 2 and at least twice the number of keys */
+	int size;
+	struct {
+		uint32_t hash;
+		/* Index of the key token, -1 for an empty slot */
+		int key;
+	} slots[];
+};
+
+static bool token_matches_strn(jparse_ctx_t *ctx, json_tok_t *tok, const char *str, int len)
+{
+	return ((tok->end - tok->start) == len)
+		&& (memcmp(ctx->js + tok->start, str, len) == 0);
+}
+
 static bool token_matches_str(jparse_ctx_t *ctx, json_tok_t *tok, char *str)
 {
-	char *js = ctx->js;
-	return ((strncmp(js + tok->start, str, strlen(str)) == 0)
-			&& (strlen(str) == (size_t) (tok->end - tok->start)));
+	return token_matches_strn(ctx, tok, str, strlen(str));
 }
 
-static json_tok_t *json_skip_elem(json_tok_t *token)
+/* FNV-1a */
+static uint32_t json_key_hash(const char *str, int len)
 {
-	json_tok_t *cur = token;
-	int cnt = cur->size;
-	while (cnt--) {
-		cur++;
-		cur = json_skip_elem(cur);
+	uint32_t hash = 2166136261u;
+	while (len--) {
+		hash ^= (uint8_t)*str++;
+		hash *= 16777619u;
 	}
-	return cur;
+	return hash;
+}
+
+/* Returns the index of the array, object or key that contains the token, or -1 for the root.
+ * Compact tokens have no parent links, so the tokens before this one are scanned instead.
+ */
+static int json_tok_parent(jparse_ctx_t *jctx, json_tok_t *tok)
+{
+#ifdef JSMN_PARENT_LINKS
+	(void)jctx;
+	return tok->parent;
+#else
+	/* The parent is the closest token before this one whose subtree covers it */
+	int i = tok - jctx->tokens, j;
+	for (j = i - 1; j >= 0; j--) {
+		if (jctx->tokens[j].next > i)
+			return j;
+	}
+	return -1;
+#endif
+}
+
+static int json_move_to_parent(jparse_ctx_t *jctx)
+{
+	int parent = json_tok_parent(jctx, jctx->cur);
+	if (parent < 0)
+		return -OS_FAIL;
+	jctx->cur = &jctx->tokens[parent];
+	return OS_SUCCESS;
+}
+
+/* Returns the last token of the element's subtree, i.e. the one just before its next sibling */
+static json_tok_t *json_skip_elem(jparse_ctx_t *jctx, json_tok_t *token)
+{
+	return &jctx->tokens[token->next - 1];
 }
 
 static int json_tok_to_bool(jparse_ctx_t *jctx, json_tok_t *tok, bool *val)
@@ -52,43 +122,488 @@ static int json_tok_to_bool(jparse_ctx_t *jctx, json_tok_t *tok, bool *val)
 	return OS_SUCCESS;
 }
 
-static int json_tok_to_int(jparse_ctx_t *jctx, json_tok_t *tok, int *val)
+/* Decimal number, as value = mant * 10^exp10 */
+typedef struct {
+	uint64_t mant;
+	int exp10;
+	bool neg;
+	/* Significant digits beyond the 19 that fit in mant were dropped */
+	bool truncated;
+} json_num_t;
+
+#define JSON_NUM_MAX_DIGITS	19
+#define JSON_NUM_MAX_EXP	9999
+
+static const uint64_t json_pow10_u64[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+	100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+	10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static const float json_pow10_f[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const double json_pow10_d[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Parses [str, end) as an integer, failing on anything else or on overflow */
+static int json_str_to_int64(const char *str, const char *end, int64_t *val)
 {
-	char *tok_start = &jctx->js[tok->start];
-	char *tok_end = &jctx->js[tok->end];
-	char *endptr;
-	int i = strtoul(tok_start, &endptr, 10);
-	if (endptr == tok_end) {
-		*val = i;
-		return OS_SUCCESS;
+	bool neg = false;
+	if ((str < end) && (*str == '-')) {
+		neg = true;
+		str++;
 	}
-	return -OS_FAIL;
+	if (str == end)
+		return -OS_FAIL;
+	uint64_t limit = neg ? ((uint64_t)INT64_MAX + 1) : (uint64_t)INT64_MAX;
+	uint64_t mag = 0;
+	for (; str < end; str++) {
+		unsigned int digit = (unsigned int)(*str - '0');
+		if (digit > 9)
+			return -OS_FAIL;
+		if (mag > (limit - digit) / 10)
+			return -OS_FAIL;
+		mag = mag * 10 + digit;
+	}
+	/* Written so as to not overflow for INT64_MIN */
+	*val = neg ? (-(int64_t)(mag - 1) - 1) : (int64_t)mag;
+	return OS_SUCCESS;
 }
 
-static int json_tok_to_int64(jparse_ctx_t *jctx, json_tok_t *tok, int64_t *val)
+/* Parses [str, end) as a JSON number without converting it to binary */
+static int json_str_to_num(const char *str, const char *end, json_num_t *num)
 {
-	char *tok_start = &jctx->js[tok->start];
-	char *tok_end = &jctx->js[tok->end];
-	char *endptr;
-	int64_t i64 = strtoull(tok_start, &endptr, 10);
-	if (endptr == tok_end) {
-		*val = i64;
+	memset(num, 0, sizeof(json_num_t));
+	if ((str < end) && (*str == '-')) {
+		num->neg = true;
+		str++;
+	}
+	int digits = 0, sig_digits = 0;
+	bool frac = false;
+	for (; str < end; str++) {
+		char c = *str;
+		if ((c == '.') && !frac) {
+			frac = true;
+			continue;
+		}
+		unsigned int digit = (unsigned int)(c - '0');
+		if (digit > 9)
+			break;
+		digits++;
+		if ((sig_digits == 0) && (digit == 0)) {
+			/* Leading zeros are not significant */
+			if (frac)
+				num->exp10--;
+			continue;
+		}
+		if (sig_digits < JSON_NUM_MAX_DIGITS) {
+			num->mant = num->mant * 10 + digit;
+			sig_digits++;
+			if (frac)
+				num->exp10--;
+		} else {
+			if (digit)
+				num->truncated = true;
+			if (!frac)
+				num->exp10++;
+		}
+	}
+	if (!digits)
+		return -OS_FAIL;
+	if ((str < end) && ((*str == 'e') || (*str == 'E'))) {
+		str++;
+		bool exp_neg = false;
+		if ((str < end) && ((*str == '-') || (*str == '+'))) {
+			exp_neg = (*str == '-');
+			str++;
+		}
+		if (str == end)
+			return -OS_FAIL;
+		int exp = 0;
+		for (; str < end; str++) {
+			unsigned int digit = (unsigned int)(*str - '0');
+			if (digit > 9)
+				return -OS_FAIL;
+			if (exp < JSON_NUM_MAX_EXP)
+				exp = exp * 10 + digit;
+		}
+		num->exp10 += exp_neg ? -exp : exp;
+	}
+	if (str != end)
+		return -OS_FAIL;
+	return OS_SUCCESS;
+}
+
+/* Decimal digits kept by the slow path. Deciding how a float rounds never needs more
+ * than about 112 significant digits, and anything beyond is kept track of as truncated.
+ */
+#define JSON_DEC_MAX_DIGITS	200
+/* The most bits shifted at once, so that the 64 bit accumulators cannot overflow */
+#define JSON_DEC_MAX_SHIFT	60
+
+/* A decimal 0.d[0]d[1]...d[nd-1] * 10^dp, with the digits as values from 0 to 9 */
+typedef struct {
+	uint8_t d[JSON_DEC_MAX_DIGITS + 20];
+	int nd;
+	int dp;
+	/* Nonzero digits were dropped after d[nd-1] */
+	bool trunc;
+} json_dec_t;
+
+/* Loads the digits of a number already validated by json_str_to_num() */
+static void json_dec_init(json_dec_t *dec, const char *str, const char *end)
+{
+	memset(dec, 0, sizeof(json_dec_t));
+	if (*str == '-')
+		str++;
+	bool frac = false;
+	for (; str < end; str++) {
+		char c = *str;
+		if (c == '.') {
+			frac = true;
+			continue;
+		}
+		if ((c < '0') || (c > '9'))
+			break;
+		if ((c == '0') && (dec->nd == 0)) {
+			if (frac)
+				dec->dp--;
+			continue;
+		}
+		if (!frac)
+			dec->dp++;
+		if (dec->nd < JSON_DEC_MAX_DIGITS)
+			dec->d[dec->nd++] = c - '0';
+		else if (c != '0')
+			dec->trunc = true;
+	}
+	if ((str < end) && ((*str == 'e') || (*str == 'E'))) {
+		str++;
+		bool exp_neg = false;
+		if ((*str == '-') || (*str == '+')) {
+			exp_neg = (*str == '-');
+			str++;
+		}
+		int exp = 0;
+		for (; str < end; str++) {
+			if (exp < JSON_NUM_MAX_EXP)
+				exp = exp * 10 + (*str - '0');
+		}
+		dec->dp += exp_neg ? -exp : exp;
+	}
+	while ((dec->nd > 0) && (dec->d[dec->nd - 1] == 0))
+		dec->nd--;
+}
+
+static void json_dec_trim(json_dec_t *dec)
+{
+	while ((dec->nd > 0) && (dec->d[dec->nd - 1] == 0))
+		dec->nd--;
+	if (dec->nd == 0)
+		dec->dp = 0;
+}
+
+/* Multiplies by 2^k. The digits are worked out from the last one into room for as many
+ * new leading digits as there can be, then moved back to the start.
+ */
+static void json_dec_left_shift(json_dec_t *dec, int k)
+{
+	int delta = ((k * 1233) >> 12) + 1;
+	int w = dec->nd + delta;
+	uint64_t n = 0;
+	int r;
+	for (r = dec->nd - 1; r >= 0; r--) {
+		n += (uint64_t)dec->d[r] << k;
+		uint64_t quo = n / 10;
+		dec->d[--w] = n - quo * 10;
+		n = quo;
+	}
+	while (n > 0) {
+		uint64_t quo = n / 10;
+		dec->d[--w] = n - quo * 10;
+		n = quo;
+	}
+	int nd = dec->nd + delta - w;
+	memmove(dec->d, dec->d + w, nd);
+	dec->dp += delta - w;
+	for (r = JSON_DEC_MAX_DIGITS; r < nd; r++) {
+		if (dec->d[r])
+			dec->trunc = true;
+	}
+	dec->nd = (nd > JSON_DEC_MAX_DIGITS) ? JSON_DEC_MAX_DIGITS : nd;
+	json_dec_trim(dec);
+}
+
+/* Divides by 2^k */
+static void json_dec_right_shift(json_dec_t *dec, int k)
+{
+	int r = 0, w = 0;
+	uint64_t n = 0;
+	/* Enough leading digits for the first output digit */
+	for (; (n >> k) == 0; r++) {
+		if (r >= dec->nd) {
+			if (n == 0) {
+				dec->nd = 0;
+				return;
+			}
+			while ((n >> k) == 0) {
+				n *= 10;
+				r++;
+			}
+			break;
+		}
+		n = n * 10 + dec->d[r];
+	}
+	dec->dp -= r - 1;
+	uint64_t mask = (1ULL << k) - 1;
+	for (; r < dec->nd; r++) {
+		uint8_t digit = dec->d[r];
+		dec->d[w++] = n >> k;
+		n = ((n & mask) * 10) + digit;
+	}
+	while (n > 0) {
+		uint8_t digit = n >> k;
+		n &= mask;
+		if (w < JSON_DEC_MAX_DIGITS)
+			dec->d[w++] = digit;
+		else if (digit)
+			dec->trunc = true;
+		n *= 10;
+	}
+	dec->nd = w;
+	json_dec_trim(dec);
+}
+
+static void json_dec_shift(json_dec_t *dec, int k)
+{
+	if (dec->nd == 0)
+		return;
+	for (; k > JSON_DEC_MAX_SHIFT; k -= JSON_DEC_MAX_SHIFT)
+		json_dec_left_shift(dec, JSON_DEC_MAX_SHIFT);
+	for (; k < -JSON_DEC_MAX_SHIFT; k += JSON_DEC_MAX_SHIFT)
+		json_dec_right_shift(dec, JSON_DEC_MAX_SHIFT);
+	if (k > 0)
+		json_dec_left_shift(dec, k);
+	else if (k < 0)
+		json_dec_right_shift(dec, -k);
+}
+
+/* The integer part, rounded half to even. Only called with a few digits before the point */
+static uint32_t json_dec_rounded(json_dec_t *dec)
+{
+	uint32_t n = 0;
+	int i;
+	for (i = 0; i < dec->dp; i++)
+		n = n * 10 + ((i < dec->nd) ? dec->d[i] : 0);
+	if ((dec->dp >= 0) && (dec->dp < dec->nd)) {
+		if ((dec->d[dec->dp] == 5) && (dec->dp + 1 == dec->nd) && !dec->trunc)
+			n += n & 1;
+		else if (dec->d[dec->dp] >= 5)
+			n++;
+	}
+	return n;
+}
+
+/* Exact conversion of any number to the nearest float by shifting it in decimal until
+ * the 24 bits of the mantissa are in its integer part (Simple Decimal Conversion, as in
+ * Go's strconv). Slow, but only needed for the rare numbers the fast path cannot round.
+ */
+static float json_dec_to_float(const char *str, const char *end)
+{
+	/* Shifts which bring the first digit of 10^dp down to at least 1 */
+	static const uint8_t pow2_shift[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+	json_dec_t dec;
+	json_dec_init(&dec, str, end);
+	bool neg = (*str == '-');
+	uint32_t bits;
+	if ((dec.nd == 0) || (dec.dp < -46)) {
+		bits = 0;
+	} else if (dec.dp > 39) {
+		bits = 0x7F800000;
+	} else {
+		/* Into [0.5, 1), tracking the power of 2 */
+		int exp = 0;
+		while (dec.dp > 0) {
+			int n = (dec.dp >= (int)sizeof(pow2_shift)) ? 27 : pow2_shift[dec.dp];
+			json_dec_shift(&dec, -n);
+			exp += n;
+		}
+		while ((dec.dp < 0) || ((dec.dp == 0) && (dec.d[0] < 5))) {
+			int n = (-dec.dp >= (int)sizeof(pow2_shift)) ? 27 : pow2_shift[-dec.dp];
+			json_dec_shift(&dec, n);
+			exp -= n;
+		}
+		/* Into [1, 2), as a float mantissa. Subnormals stay at the lowest exponent */
+		exp--;
+		if (exp < -126) {
+			json_dec_shift(&dec, -(-126 - exp));
+			exp = -126;
+		}
+		json_dec_shift(&dec, 24);
+		uint32_t mant = json_dec_rounded(&dec);
+		if (mant == (1u << 24)) {
+			mant >>= 1;
+			exp++;
+		}
+		if (exp > 127) {
+			bits = 0x7F800000;
+		} else if (!(mant & (1u << 23))) {
+			bits = mant;
+		} else {
+			bits = ((uint32_t)(exp + 127) << 23) | (mant & 0x7FFFFF);
+		}
+	}
+	if (neg)
+		bits |= 0x80000000;
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+/* Exact. Most numbers are correctly rounded by a single float or double operation, and
+ * the rest go through json_dec_to_float(), reading nothing outside [str, end).
+ */
+static int json_str_to_float(const char *str, const char *end, float *val)
+{
+	json_num_t num;
+	if (json_str_to_num(str, end, &num) != OS_SUCCESS)
+		return -OS_FAIL;
+	if (num.mant == 0) {
+		*val = num.neg ? -0.0f : 0.0f;
 		return OS_SUCCESS;
 	}
-	return -OS_FAIL;
+	if (!num.truncated && (num.mant <= (1ULL << 24))
+			&& (num.exp10 >= -10) && (num.exp10 <= 10)) {
+		float f = (float)num.mant;
+		f = (num.exp10 >= 0) ? f * json_pow10_f[num.exp10] : f / json_pow10_f[-num.exp10];
+		*val = num.neg ? -f : f;
+		return OS_SUCCESS;
+	}
+	if (!num.truncated && (num.mant <= (1ULL << 53))
+			&& (num.exp10 >= -22) && (num.exp10 <= 22)) {
+		double d = (double)num.mant;
+		d = (num.exp10 >= 0) ? d * json_pow10_d[num.exp10] : d / json_pow10_d[-num.exp10];
+		/* Rounding the double to float is a second rounding. It can only go wrong
+		 * if the double landed exactly halfway between two floats, or is subnormal
+		 * as a float.
+		 */
+		uint64_t bits;
+		memcpy(&bits, &d, sizeof(bits));
+		if (((bits & 0x1FFFFFFFULL) != 0x10000000ULL) && (d >= 1.17549435e-38)
+				&& (d <= 3.40282347e+38)) {
+			*val = num.neg ? -(float)d : (float)d;
+			return OS_SUCCESS;
+		}
+	}
+	*val = json_dec_to_float(str, end);
+	return OS_SUCCESS;
+}
+
+/* Converts [str, end) to value * 10^scale, rounded half away from zero */
+static int json_str_to_fixed(const char *str, const char *end, int scale, int32_t *val)
+{
+	json_num_t num;
+	if (json_str_to_num(str, end, &num) != OS_SUCCESS)
+		return -OS_FAIL;
+	uint64_t mag = num.mant;
+	int exp = num.exp10 + scale;
+	if (mag == 0) {
+		/* Nothing to scale */
+	} else if (exp >= 0) {
+		if (exp > JSON_NUM_MAX_DIGITS)
+			return -OS_FAIL;
+		if (mag > (UINT64_MAX / json_pow10_u64[exp]))
+			return -OS_FAIL;
+		mag *= json_pow10_u64[exp];
+	} else if (-exp > JSON_NUM_MAX_DIGITS) {
+		mag = 0;
+	} else {
+		uint64_t div = json_pow10_u64[-exp];
+		uint64_t rem = mag % div;
+		mag /= div;
+		if (rem >= (div - rem))
+			mag++;
+	}
+	if (mag > (num.neg ? ((uint64_t)INT32_MAX + 1) : (uint64_t)INT32_MAX))
+		return -OS_FAIL;
+	*val = num.neg ? (int32_t)(-(int64_t)mag) : (int32_t)mag;
+	return OS_SUCCESS;
+}
+
+static int json_tok_to_int(jparse_ctx_t *jctx, json_tok_t *tok, int *val)
+{
+	int64_t i64;
+	if (json_str_to_int64(&jctx->js[tok->start], &jctx->js[tok->end], &i64) != OS_SUCCESS)
+		return -OS_FAIL;
+	if ((i64 < INT32_MIN) || (i64 > INT32_MAX))
+		return -OS_FAIL;
+	*val = (int)i64;
+	return OS_SUCCESS;
+}
+
+static int json_tok_to_int64(jparse_ctx_t *jctx, json_tok_t *tok, int64_t *val)
+{
+	return json_str_to_int64(&jctx->js[tok->start], &jctx->js[tok->end], val);
 }
 
 static int json_tok_to_float(jparse_ctx_t *jctx, json_tok_t *tok, float *val)
 {
-	char *tok_start = &jctx->js[tok->start];
-	char *tok_end = &jctx->js[tok->end];
-	char *endptr;
-	float f = strtof(tok_start, &endptr);
-	if (endptr == tok_end) {
-		*val = f;
-		return OS_SUCCESS;
+	return json_str_to_float(&jctx->js[tok->start], &jctx->js[tok->end], val);
+}
+
+static int json_tok_to_fixed(jparse_ctx_t *jctx, json_tok_t *tok, int scale, int32_t *val)
+{
+	return json_str_to_fixed(&jctx->js[tok->start], &jctx->js[tok->end], scale, val);
+}
+
+static int json_tok_to_int_array(jparse_ctx_t *jctx, json_tok_t *arr, int *val, int max_elem, int *num_elem)
+{
+	if (arr->size > max_elem)
+		return -OS_FAIL;
+	/* Numbers have no children, so the elements are simply the tokens following the array */
+	json_tok_t *tok = arr + 1;
+	int i;
+	for (i = 0; i < arr->size; i++, tok++) {
+		if ((tok->type != JSMN_PRIMITIVE) || (json_tok_to_int(jctx, tok, &val[i]) != OS_SUCCESS))
+			return -OS_FAIL;
 	}
-	return -OS_FAIL;
+	*num_elem = arr->size;
+	return OS_SUCCESS;
+}
+
+static int json_tok_to_int64_array(jparse_ctx_t *jctx, json_tok_t *arr, int64_t *val, int max_elem, int *num_elem)
+{
+	if (arr->size > max_elem)
+		return -OS_FAIL;
+	/* Numbers have no children, so the elements are simply the tokens following the array */
+	json_tok_t *tok = arr + 1;
+	int i;
+	for (i = 0; i < arr->size; i++, tok++) {
+		if ((tok->type != JSMN_PRIMITIVE) || (json_tok_to_int64(jctx, tok, &val[i]) != OS_SUCCESS))
+			return -OS_FAIL;
+	}
+	*num_elem = arr->size;
+	return OS_SUCCESS;
+}
+
+static int json_tok_to_float_array(jparse_ctx_t *jctx, json_tok_t *arr, float *val, int max_elem, int *num_elem)
+{
+	if (arr->size > max_elem)
+		return -OS_FAIL;
+	/* Numbers have no children, so the elements are simply the tokens following the array */
+	json_tok_t *tok = arr + 1;
+	int i;
+	for (i = 0; i < arr->size; i++, tok++) {
+		if ((tok->type != JSMN_PRIMITIVE) || (json_tok_to_float(jctx, tok, &val[i]) != OS_SUCCESS))
+			return -OS_FAIL;
+	}
+	*num_elem = arr->size;
+	return OS_SUCCESS;
 }
 
 static int json_tok_to_string(jparse_ctx_t *jctx, json_tok_t *tok, char *val, int size)
@@ -100,6 +615,229 @@ static int json_tok_to_string(jparse_ctx_t *jctx, json_tok_t *tok, char *val, in
 	return OS_SUCCESS;
 }
 
+static int json_tok_to_strview(jparse_ctx_t *jctx, json_tok_t *tok, char **val, int *len)
+{
+	*val = jctx->js + tok->start;
+	*len = tok->end - tok->start;
+	return OS_SUCCESS;
+}
+
+static int json_hex4(const char *str)
+{
+	int val = 0;
+	for (int i = 0; i < 4; i++) {
+		char c = str[i];
+		val <<= 4;
+		if (c >= '0' && c <= '9')
+			val |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			val |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			val |= c - 'A' + 10;
+		else
+			return -1;
+	}
+	return val;
+}
+
+static int json_utf8_encode(char *out, uint32_t cp)
+{
+	if (cp < 0x80) {
+		out[0] = cp;
+		return 1;
+	} else if (cp < 0x800) {
+		out[0] = 0xC0 | (cp >> 6);
+		out[1] = 0x80 | (cp & 0x3F);
+		return 2;
+	} else if (cp < 0x10000) {
+		out[0] = 0xE0 | (cp >> 12);
+		out[1] = 0x80 | ((cp >> 6) & 0x3F);
+		out[2] = 0x80 | (cp & 0x3F);
+		return 3;
+	}
+	out[0] = 0xF0 | (cp >> 18);
+	out[1] = 0x80 | ((cp >> 12) & 0x3F);
+	out[2] = 0x80 | ((cp >> 6) & 0x3F);
+	out[3] = 0x80 | (cp & 0x3F);
+	return 4;
+}
+
+/* Decodes the escapes in str[0..len) into out, which has room for size bytes,
+ * and returns the new length, or -1 if an escape is invalid or the result does
+ * not fit. out may be str itself, as every escape sequence is at least as long
+ * as its UTF-8 encoding. Unpaired surrogates become U+FFFD.
+ */
+static int json_str_unescape(char *out, int size, const char *str, int len)
+{
+	const char *in = str, *end = str + len;
+	char *out_start = out, *out_end = out + size;
+	while (in < end) {
+		const char *esc = memchr(in, '\\', end - in);
+		int n = (esc ? esc : end) - in;
+		if (n > (out_end - out))
+			return -1;
+		if (out != in)
+			memmove(out, in, n);
+		out += n;
+		if (!esc)
+			break;
+		in = esc + 1;
+		if (in == end)
+			return -1;
+		char utf8[4];
+		int utf8_len = 1;
+		char c = *in++;
+		switch (c) {
+		case '"':
+		case '\\':
+		case '/':
+			utf8[0] = c;
+			break;
+		case 'b':
+			utf8[0] = '\b';
+			break;
+		case 'f':
+			utf8[0] = '\f';
+			break;
+		case 'n':
+			utf8[0] = '\n';
+			break;
+		case 'r':
+			utf8[0] = '\r';
+			break;
+		case 't':
+			utf8[0] = '\t';
+			break;
+		case 'u': {
+			if ((end - in) < 4)
+				return -1;
+			int cp = json_hex4(in);
+			if (cp < 0)
+				return -1;
+			in += 4;
+			if (cp >= 0xD800 && cp <= 0xDBFF) {
+				int lo = ((end - in) >= 6 && in[0] == '\\' && in[1] == 'u') ? json_hex4(in + 2) : -1;
+				if (lo >= 0xDC00 && lo <= 0xDFFF) {
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+					in += 6;
+				} else {
+					cp = 0xFFFD;
+				}
+			} else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+				cp = 0xFFFD;
+			}
+			utf8_len = json_utf8_encode(utf8, cp);
+			break;
+		}
+		default:
+			return -1;
+		}
+		if (utf8_len > (out_end - out))
+			return -1;
+		memcpy(out, utf8, utf8_len);
+		out += utf8_len;
+	}
+	return out - out_start;
+}
+
+static int json_tok_to_string_inplace(jparse_ctx_t *jctx, json_tok_t *tok, char **val, int *len)
+{
+	char *str = jctx->js + tok->start;
+	/* The opening quote is replaced by a NULL once the string has been decoded,
+	 * so that decoding it again does not touch it.
+	 */
+	if (str[-1] != '\0') {
+		int new_len = json_str_unescape(str, tok->end - tok->start, str, tok->end - tok->start);
+		if (new_len < 0)
+			return -OS_FAIL;
+		str[-1] = '\0';
+		str[new_len] = '\0';
+		tok->end = tok->start + new_len;
+	}
+	*val = str;
+	*len = tok->end - tok->start;
+	return OS_SUCCESS;
+}
+
+static int json_tok_to_string_decoded(jparse_ctx_t *jctx, json_tok_t *tok, char *val, int size)
+{
+	/* Already decoded by json_tok_to_string_inplace() */
+	if (jctx->js[tok->start - 1] == '\0')
+		return json_tok_to_string(jctx, tok, val, size);
+	if (size < 1)
+		return -OS_FAIL;
+	int len = json_str_unescape(val, size - 1, jctx->js + tok->start, tok->end - tok->start);
+	if (len < 0)
+		return -OS_FAIL;
+	val[len] = 0;
+	return OS_SUCCESS;
+}
+
+static json_tok_t *json_obj_index_lookup(jparse_ctx_t *jctx, json_obj_index_t *index,
+		const char *key, int len, uint32_t hash)
+{
+	int slot = hash & (index->size - 1);
+	while (index->slots[slot].key >= 0) {
+		json_tok_t *tok = &jctx->tokens[index->slots[slot].key];
+		if ((index->slots[slot].hash == hash) && token_matches_strn(jctx, tok, key, len))
+			return tok;
+		slot = (slot + 1) & (index->size - 1);
+	}
+	return NULL;
+}
+
+/* Returns the table of the object, if it has one, moving it to the front of the chain
+ * as the next lookups are most likely in the same object
+ */
+static json_obj_index_t *json_obj_index_find(jparse_ctx_t *jctx, int obj)
+{
+	json_obj_index_t **prev = &jctx->obj_index;
+	json_obj_index_t *index;
+	for (index = *prev; index; prev = &index->next, index = index->next) {
+		if (index->obj == obj) {
+			*prev = index->next;
+			index->next = jctx->obj_index;
+			jctx->obj_index = index;
+			return index;
+		}
+	}
+	return NULL;
+}
+
+static json_obj_index_t *json_obj_index_build(jparse_ctx_t *jctx, int obj)
+{
+	json_tok_t *tok = &jctx->tokens[obj];
+	int num_keys = tok->size;
+	int size = 1;
+	while (size < num_keys * 2)
+		size <<= 1;
+	json_obj_index_t *index = malloc(sizeof(json_obj_index_t) + size * sizeof(index->slots[0]));
+	if (!index)
+		return NULL;
+	index->obj = obj;
+	index->size = size;
+	int i;
+	for (i = 0; i < size; i++)
+		index->slots[i].key = -1;
+	while (num_keys--) {
+		tok++;
+		int len = tok->end - tok->start;
+		uint32_t hash = json_key_hash(jctx->js + tok->start, len);
+		/* Only the first of duplicate keys is reachable, same as with the linear search */
+		if (!json_obj_index_lookup(jctx, index, jctx->js + tok->start, len, hash)) {
+			int slot = hash & (size - 1);
+			while (index->slots[slot].key >= 0)
+				slot = (slot + 1) & (size - 1);
+			index->slots[slot].hash = hash;
+			index->slots[slot].key = tok - jctx->tokens;
+		}
+		tok = json_skip_elem(jctx, tok);
+	}
+	index->next = jctx->obj_index;
+	jctx->obj_index = index;
+	return index;
+}
+
 static json_tok_t *json_obj_search(jparse_ctx_t *jctx, char *key)
 {
 	json_tok_t *tok = jctx->cur;
@@ -109,11 +847,22 @@ static json_tok_t *json_obj_search(jparse_ctx_t *jctx, char *key)
 	if (tok->type != JSMN_OBJECT)
 		return NULL;
 
+	int len = strlen(key);
+	if (jctx->obj_index_enabled && (size >= JSON_OBJ_INDEX_MIN_KEYS)) {
+		int obj = tok - jctx->tokens;
+		json_obj_index_t *index = json_obj_index_find(jctx, obj);
+		if (!index)
+			index = json_obj_index_build(jctx, obj);
+		if (index)
+			return json_obj_index_lookup(jctx, index, key, len, json_key_hash(key, len));
+		/* Fall back to the linear search if the index could not be allocated */
+	}
+
 	while (size--) {
 		tok++;
-		if (token_matches_str(jctx, tok, key))
+		if (token_matches_strn(jctx, tok, key, len))
 			return tok;
-		tok = json_skip_elem(tok);
+		tok = json_skip_elem(jctx, tok);
 	}
 	return NULL;
 }
@@ -141,16 +890,10 @@ int json_obj_get_array(jparse_ctx_t *jctx, char *name, int *num_elem)
 
 int json_obj_leave_array(jparse_ctx_t *jctx)
 {
-	/* The array's parent will be the key */
-	if (jctx->cur->parent < 0)
+	/* The array's parent will be the key and the key's parent will be the actual parent object */
+	if (json_move_to_parent(jctx) != OS_SUCCESS)
 		return -OS_FAIL;
-	jctx->cur = &jctx->tokens[jctx->cur->parent];
-
-	/* The key's parent will be the actual parent object */
-	if (jctx->cur->parent < 0)
-		return -OS_FAIL;
-	jctx->cur = &jctx->tokens[jctx->cur->parent];
-	return OS_SUCCESS;
+	return json_move_to_parent(jctx);
 }
 
 int json_obj_get_object(jparse_ctx_t *jctx, char *name)
@@ -164,16 +907,10 @@ int json_obj_get_object(jparse_ctx_t *jctx, char *name)
 
 int json_obj_leave_object(jparse_ctx_t *jctx)
 {
-	/* The objects's parent will be the key */
-	if (jctx->cur->parent < 0)
+	/* The objects's parent will be the key and the key's parent will be the actual parent object */
+	if (json_move_to_parent(jctx) != OS_SUCCESS)
 		return -OS_FAIL;
-	jctx->cur = &jctx->tokens[jctx->cur->parent];
-
-	/* The key's parent will be the actual parent object */
-	if (jctx->cur->parent < 0)
-		return -OS_FAIL;
-	jctx->cur = &jctx->tokens[jctx->cur->parent];
-	return OS_SUCCESS;
+	return json_move_to_parent(jctx);
 }
 
 int json_obj_get_bool(jparse_ctx_t *jctx, char *name, bool *val)
@@ -208,6 +945,14 @@ int json_obj_get_float(jparse_ctx_t *jctx, char *name, float *val)
 	return json_tok_to_float(jctx, tok, val);
 }
 
+int json_obj_get_fixed(jparse_ctx_t *jctx, char *name, int scale, int32_t *val)
+{
+	json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_PRIMITIVE);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_fixed(jctx, tok, scale, val);
+}
+
 int json_obj_get_string(jparse_ctx_t *jctx, char *name, char *val, int size)
 {
 	json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_STRING);
@@ -225,6 +970,22 @@ int json_obj_get_strlen(jparse_ctx_t *jctx, char *name, int *strlen)
 	return OS_SUCCESS;
 }
 
+int json_obj_get_strview(jparse_ctx_t *jctx, char *name, char **val, int *len)
+{
+	json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_STRING);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_strview(jctx, tok, val, len);
+}
+
+int json_obj_get_string_inplace(jparse_ctx_t *jctx, char *name, char **val, int *len)
+{
+	json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_STRING);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_string_inplace(jctx, tok, val, len);
+}
+
 int json_obj_get_object_str(jparse_ctx_t *jctx, char *name, char *val, int size)
 {
 	json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_OBJECT);
@@ -258,6 +1019,30 @@ int json_obj_get_array_strlen(jparse_ctx_t *jctx, char *name, int *strlen)
 	return OS_SUCCESS;
 }
 
+int json_obj_get_int_array(jparse_ctx_t *jctx, char *name, int *val, int max_elem, int *num_elem)
+{
+	json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_ARRAY);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_int_array(jctx, tok, val, max_elem, num_elem);
+}
+
+int json_obj_get_int64_array(jparse_ctx_t *jctx, char *name, int64_t *val, int max_elem, int *num_elem)
+{
+	json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_ARRAY);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_int64_array(jctx, tok, val, max_elem, num_elem);
+}
+
+int json_obj_get_float_array(jparse_ctx_t *jctx, char *name, float *val, int max_elem, int *num_elem)
+{
+	json_tok_t *tok = json_obj_get_val_tok(jctx, name, JSMN_ARRAY);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_float_array(jctx, tok, val, max_elem, num_elem);
+}
+
 static json_tok_t *json_arr_search(jparse_ctx_t *ctx, uint32_t index)
 {
 	json_tok_t *tok = ctx->cur;
@@ -265,12 +1050,20 @@ static json_tok_t *json_arr_search(jparse_ctx_t *ctx, uint32_t index)
 		return NULL;
 	if (index > (uint32_t)(tok->size - 1))
 		return NULL;
-	/* Increment by 1, so that token points to index 0 */
-	tok++;
-	while (index--) {
-		tok = json_skip_elem(tok);
+	json_tok_t *arr = tok;
+	uint32_t cur_index = 0;
+	if ((ctx->arr_cache == arr) && (ctx->arr_cache_index <= index)) {
+		tok = ctx->arr_cache_elem;
+		cur_index = ctx->arr_cache_index;
+	} else {
+		/* Increment by 1, so that token points to index 0 */
 		tok++;
 	}
+	for (; cur_index < index; cur_index++)
+		tok = &ctx->tokens[tok->next];
+	ctx->arr_cache = arr;
+	ctx->arr_cache_elem = tok;
+	ctx->arr_cache_index = index;
 	return tok;
 }
 static json_tok_t *json_arr_get_val_tok(jparse_ctx_t *jctx, uint32_t index, jsmntype_t type)
@@ -294,10 +1087,7 @@ int json_arr_get_array(jparse_ctx_t *jctx, uint32_t index)
 
 int json_arr_leave_array(jparse_ctx_t *jctx)
 {
-	if (jctx->cur->parent < 0)
-		return -OS_FAIL;
-	jctx->cur = &jctx->tokens[jctx->cur->parent];
-	return OS_SUCCESS;
+	return json_move_to_parent(jctx);
 }
 
 int json_arr_get_object(jparse_ctx_t *jctx, uint32_t index)
@@ -311,10 +1101,7 @@ int json_arr_get_object(jparse_ctx_t *jctx, uint32_t index)
 
 int json_arr_leave_object(jparse_ctx_t *jctx)
 {
-	if (jctx->cur->parent < 0)
-		return -OS_FAIL;
-	jctx->cur = &jctx->tokens[jctx->cur->parent];
-	return OS_SUCCESS;
+	return json_move_to_parent(jctx);
 }
 
 int json_arr_get_bool(jparse_ctx_t *jctx, uint32_t index, bool *val)
@@ -349,6 +1136,14 @@ int json_arr_get_float(jparse_ctx_t *jctx, uint32_t index, float *val)
 	return json_tok_to_float(jctx, tok, val);
 }
 
+int json_arr_get_fixed(jparse_ctx_t *jctx, uint32_t index, int scale, int32_t *val)
+{
+	json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_PRIMITIVE);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_fixed(jctx, tok, scale, val);
+}
+
 int json_arr_get_string(jparse_ctx_t *jctx, uint32_t index, char *val, int size)
 {
 	json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_STRING);
@@ -366,6 +1161,46 @@ int json_arr_get_strlen(jparse_ctx_t *jctx, uint32_t index, int *strlen)
 	return OS_SUCCESS;
 }
 
+int json_arr_get_strview(jparse_ctx_t *jctx, uint32_t index, char **val, int *len)
+{
+	json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_STRING);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_strview(jctx, tok, val, len);
+}
+
+int json_arr_get_string_inplace(jparse_ctx_t *jctx, uint32_t index, char **val, int *len)
+{
+	json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_STRING);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_string_inplace(jctx, tok, val, len);
+}
+
+int json_arr_get_int_array(jparse_ctx_t *jctx, uint32_t index, int *val, int max_elem, int *num_elem)
+{
+	json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_ARRAY);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_int_array(jctx, tok, val, max_elem, num_elem);
+}
+
+int json_arr_get_int64_array(jparse_ctx_t *jctx, uint32_t index, int64_t *val, int max_elem, int *num_elem)
+{
+	json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_ARRAY);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_int64_array(jctx, tok, val, max_elem, num_elem);
+}
+
+int json_arr_get_float_array(jparse_ctx_t *jctx, uint32_t index, float *val, int max_elem, int *num_elem)
+{
+	json_tok_t *tok = json_arr_get_val_tok(jctx, index, JSMN_ARRAY);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_float_array(jctx, tok, val, max_elem, num_elem);
+}
+
 int json_parse_start(jparse_ctx_t *jctx, char *js, int len)
 {
 	memset(jctx, 0, sizeof(jparse_ctx_t));
@@ -389,9 +1224,484 @@ int json_parse_start(jparse_ctx_t *jctx, char *js, int len)
 	return OS_SUCCESS;
 }
 
+static int json_iter_init(jparse_ctx_t *jctx, json_tok_t *tok, json_iter_t *iter)
+{
+	/* A failed begin leaves an iterator which is already at its end */
+	memset(iter, 0, sizeof(json_iter_t));
+	if ((tok->type != JSMN_OBJECT) && (tok->type != JSMN_ARRAY))
+		return -OS_FAIL;
+	iter->jctx = jctx;
+	iter->elem = tok + 1;
+	iter->remaining = tok->size;
+	iter->is_object = (tok->type == JSMN_OBJECT);
+	return OS_SUCCESS;
+}
+
+static json_tok_t *json_iter_val_tok(json_iter_t *iter, jsmntype_t type)
+{
+	if (!iter->remaining)
+		return NULL;
+	/* The value of an object member immediately follows its key */
+	json_tok_t *tok = iter->is_object ? iter->elem + 1 : iter->elem;
+	if (tok->type != type)
+		return NULL;
+	return tok;
+}
+
+int json_iter_begin(jparse_ctx_t *jctx, json_iter_t *iter)
+{
+	return json_iter_init(jctx, jctx->cur, iter);
+}
+
+int json_iter_begin_child(json_iter_t *parent, json_iter_t *iter)
+{
+	if (!parent->remaining) {
+		memset(iter, 0, sizeof(json_iter_t));
+		return -OS_FAIL;
+	}
+	return json_iter_init(parent->jctx,
+			parent->is_object ? parent->elem + 1 : parent->elem, iter);
+}
+
+bool json_iter_end(json_iter_t *iter)
+{
+	return iter->remaining <= 0;
+}
+
+void json_iter_next(json_iter_t *iter)
+{
+	if (iter->remaining <= 0)
+		return;
+	if (--iter->remaining)
+		iter->elem = &iter->jctx->tokens[iter->elem->next];
+}
+
+jsmntype_t json_iter_get_type(json_iter_t *iter)
+{
+	if (!iter->remaining)
+		return JSMN_UNDEFINED;
+	return iter->is_object ? iter->elem[1].type : iter->elem->type;
+}
+
+int json_iter_get_key(json_iter_t *iter, char **key, int *len)
+{
+	if (!iter->remaining || !iter->is_object)
+		return -OS_FAIL;
+	*key = iter->jctx->js + iter->elem->start;
+	*len = iter->elem->end - iter->elem->start;
+	return OS_SUCCESS;
+}
+
+bool json_iter_key_matches(json_iter_t *iter, char *key)
+{
+	if (!iter->remaining || !iter->is_object)
+		return false;
+	return token_matches_str(iter->jctx, iter->elem, key);
+}
+
+int json_iter_get_bool(json_iter_t *iter, bool *val)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_PRIMITIVE);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_bool(iter->jctx, tok, val);
+}
+
+int json_iter_get_int(json_iter_t *iter, int *val)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_PRIMITIVE);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_int(iter->jctx, tok, val);
+}
+
+int json_iter_get_int64(json_iter_t *iter, int64_t *val)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_PRIMITIVE);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_int64(iter->jctx, tok, val);
+}
+
+int json_iter_get_float(json_iter_t *iter, float *val)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_PRIMITIVE);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_float(iter->jctx, tok, val);
+}
+
+int json_iter_get_fixed(json_iter_t *iter, int scale, int32_t *val)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_PRIMITIVE);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_fixed(iter->jctx, tok, scale, val);
+}
+
+int json_iter_get_string(json_iter_t *iter, char *val, int size)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_STRING);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_string(iter->jctx, tok, val, size);
+}
+
+int json_iter_get_string_decoded(json_iter_t *iter, char *val, int size)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_STRING);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_string_decoded(iter->jctx, tok, val, size);
+}
+
+int json_iter_get_strlen(json_iter_t *iter, int *strlen)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_STRING);
+	if (!tok)
+		return -OS_FAIL;
+	*strlen = tok->end - tok->start;
+	return OS_SUCCESS;
+}
+
+int json_iter_get_strview(json_iter_t *iter, char **val, int *len)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_STRING);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_strview(iter->jctx, tok, val, len);
+}
+
+int json_iter_get_string_inplace(json_iter_t *iter, char **val, int *len)
+{
+	json_tok_t *tok = json_iter_val_tok(iter, JSMN_STRING);
+	if (!tok)
+		return -OS_FAIL;
+	return json_tok_to_string_inplace(iter->jctx, tok, val, len);
+}
+
+void json_tok_arena_init(json_tok_arena_t *arena, json_tok_t *buf, int num_tokens)
+{
+	memset(arena, 0, sizeof(json_tok_arena_t));
+	if (buf) {
+		arena->tokens = buf;
+		arena->num_tokens = num_tokens;
+	} else {
+		/* Capacity is only a hint here. The array gets allocated on first use */
+		arena->num_tokens = num_tokens;
+		arena->growable = true;
+	}
+}
+
+void json_tok_arena_free(json_tok_arena_t *arena)
+{
+	if (arena->growable && arena->tokens)
+		free(arena->tokens);
+	memset(arena, 0, sizeof(json_tok_arena_t));
+}
+
+static int json_tok_arena_grow(json_tok_arena_t *arena)
+{
+	if (!arena->growable)
+		return -OS_FAIL;
+	int num_tokens = arena->num_tokens;
+	if (arena->tokens)
+		num_tokens *= 2;
+	if (num_tokens < JSON_TOK_ARENA_MIN_TOKENS)
+		num_tokens = JSON_TOK_ARENA_MIN_TOKENS;
+	json_tok_t *tokens = realloc(arena->tokens, num_tokens * sizeof(json_tok_t));
+	if (!tokens)
+		return -OS_FAIL;
+	arena->tokens = tokens;
+	arena->num_tokens = num_tokens;
+	return OS_SUCCESS;
+}
+
+/* Tokenizes in a single pass. jsmn leaves its state at the start of the element
+ * it could not allocate a token for, so on JSMN_ERROR_NOMEM the arena is grown
+ * and parsing simply continues from there.
+ */
+static int json_parse_tokens(jparse_ctx_t *jctx, json_tok_arena_t *arena, char *js, int len)
+{
+	memset(jctx, 0, sizeof(jparse_ctx_t));
+	if (!arena->tokens && (json_tok_arena_grow(arena) != OS_SUCCESS))
+		return -OS_FAIL;
+	jsmn_init(&jctx->parser);
+	int ret;
+	while ((ret = jsmn_parse(&jctx->parser, js, len, arena->tokens, arena->num_tokens))
+			== JSMN_ERROR_NOMEM) {
+		if (json_tok_arena_grow(arena) != OS_SUCCESS)
+			break;
+	}
+	if (ret <= 0) {
+		memset(jctx, 0, sizeof(jparse_ctx_t));
+		return -OS_FAIL;
+	}
+	jctx->js = js;
+	jctx->tokens = arena->tokens;
+	jctx->num_tokens = ret;
+	jctx->tokens_borrowed = true;
+	jctx->cur = jctx->tokens;
+	return OS_SUCCESS;
+}
+
+int json_parse_start_static(jparse_ctx_t *jctx, char *js, int len, json_tok_t *buf, int buf_len)
+{
+	if (!buf)
+		return -OS_FAIL;
+	json_tok_arena_t arena;
+	json_tok_arena_init(&arena, buf, buf_len);
+	return json_parse_tokens(jctx, &arena, js, len);
+}
+
+int json_parse_start_arena(jparse_ctx_t *jctx, json_tok_arena_t *arena, char *js, int len)
+{
+	return json_parse_tokens(jctx, arena, js, len);
+}
+
+/* pos is at the opening quote. Returns the position after the closing quote */
+static int json_lazy_skip_string(const char *js, int pos, int len)
+{
+	for (pos++; ; pos++) {
+		pos = jsmn_skip_string_run(js, pos, len);
+		if ((pos >= len) || (js[pos] == '\0'))
+			return -1;
+		if (js[pos] == '"')
+			return pos + 1;
+		/* A backslash. Whatever it escapes cannot end the string */
+		pos++;
+	}
+}
+
+/* Returns the position after the value at pos. Only quotes and brackets are
+ * matched, the value is not validated.
+ */
+static int json_lazy_skip_value(const char *js, int pos, int len)
+{
+	int depth = 0;
+	while (pos < len) {
+		switch (js[pos]) {
+		case '"':
+			pos = json_lazy_skip_string(js, pos, len);
+			if (pos < 0)
+				return -1;
+			if (!depth)
+				return pos;
+			continue;
+		case '{':
+		case '[':
+			depth++;
+			break;
+		case '}':
+		case ']':
+			if (!depth)
+				return pos;
+			if (!--depth)
+				return pos + 1;
+			break;
+		case ' ':
+		case '\t':
+		case '\n':
+		case '\r':
+			if (!depth)
+				return pos;
+			pos = jsmn_skip_space(js, pos, len);
+			continue;
+		case ',':
+			if (!depth)
+				return pos;
+			break;
+		case '\0':
+			return -1;
+		default:
+			if (!depth) {
+				/* A primitive, which runs up to the next delimiter */
+				while ((pos < len) && !(jsmn_char_class[(unsigned char)js[pos]] & JSMN_CC_DELIM))
+					pos++;
+				return pos;
+			}
+			break;
+		}
+		pos++;
+	}
+	/* A primitive may end along with the document, but nothing else can */
+	return depth ? -1 : pos;
+}
+
+/* Tokenizes the value at val_start, of the key at key_start, into the arena at
+ * idx onwards. jsmn reads the value straight from the document and stops at its
+ * end, so it is scanned only once. Returns the position after the value.
+ */
+static int json_lazy_parse_member(jparse_ctx_t *jctx, json_tok_arena_t *arena, char *js, int len,
+		int *idx, int key_start, int key_end, int val_start)
+{
+	int val = *idx + 1, num_val, j;
+	json_tok_t *tok;
+	char c = js[val_start];
+
+	/* jsmn would take the next key for the value if this one were missing */
+	if ((c != '{') && (c != '[') && (c != '"') && (c != '-') && (c != 't') && (c != 'f')
+			&& (c != 'n') && ((c < '0') || (c > '9')))
+		return -1;
+	while (arena->num_tokens < val + 1) {
+		if (json_tok_arena_grow(arena) != OS_SUCCESS)
+			return -1;
+	}
+	tok = &arena->tokens[*idx];
+	tok->type = JSMN_STRING;
+	tok->start = key_start;
+	tok->end = key_end;
+	tok->size = 1;
+#ifdef JSMN_PARENT_LINKS
+	tok->parent = 0;
+#endif
+	jsmn_init(&jctx->parser);
+	jctx->parser.single_value = 1;
+	jctx->parser.pos = val_start;
+	while ((num_val = jsmn_parse(&jctx->parser, js, len, arena->tokens + val,
+			arena->num_tokens - val)) == JSMN_ERROR_NOMEM) {
+		if (json_tok_arena_grow(arena) != OS_SUCCESS)
+			return -1;
+	}
+	if (num_val <= 0)
+		return -1;
+	arena->tokens[*idx].next = val + num_val;
+	/* Positions are already right, only the links are relative to the value */
+	for (j = val; j < val + num_val; j++) {
+		tok = &arena->tokens[j];
+#ifdef JSMN_PARENT_LINKS
+		tok->parent = (tok->parent < 0) ? *idx : tok->parent + val;
+#endif
+		tok->next += val;
+	}
+	*idx = val + num_val;
+	return jctx->parser.pos;
+}
+
+int json_parse_start_lazy_arena(jparse_ctx_t *jctx, json_tok_arena_t *arena, char *js, int len,
+		char **keys, int num_keys)
+{
+	uint32_t found_keys = 0, all_keys;
+	int num_found = 0, obj_start, obj_end, pos, idx = 1, i;
+	json_tok_t *tok;
+
+	memset(jctx, 0, sizeof(jparse_ctx_t));
+	if ((num_keys <= 0) || (num_keys > JSON_PARSE_LAZY_MAX_KEYS))
+		return -OS_FAIL;
+#ifdef JSMN_COMPACT
+	if (len >= JSMN_POS_UNSET)
+		return -OS_FAIL;
+#endif
+	all_keys = (1u << num_keys) - 1;
+	pos = jsmn_skip_space(js, 0, len);
+	if ((pos == len) || (js[pos] != '{'))
+		return -OS_FAIL;
+	obj_start = pos;
+	if (!arena->tokens && (json_tok_arena_grow(arena) != OS_SUCCESS))
+		return -OS_FAIL;
+	pos = jsmn_skip_space(js, pos + 1, len);
+	if ((pos < len) && (js[pos] == '}')) {
+		obj_end = pos + 1;
+	} else {
+		while (1) {
+			if ((pos == len) || (js[pos] != '"'))
+				goto fail;
+			int key_start = pos + 1;
+			pos = json_lazy_skip_string(js, pos, len);
+			if (pos < 0)
+				goto fail;
+			int key_end = pos - 1;
+			pos = jsmn_skip_space(js, pos, len);
+			if ((pos == len) || (js[pos] != ':'))
+				goto fail;
+			int val_start = jsmn_skip_space(js, pos + 1, len);
+			if (val_start == len)
+				goto fail;
+			for (i = 0; i < num_keys; i++) {
+				if (!(found_keys & (1u << i)) && ((size_t)(key_end - key_start) == strlen(keys[i]))
+						&& (strncmp(js + key_start, keys[i], key_end - key_start) == 0))
+					break;
+			}
+			if (i < num_keys) {
+				found_keys |= (1u << i);
+				num_found++;
+				pos = json_lazy_parse_member(jctx, arena, js, len, &idx, key_start, key_end, val_start);
+			} else {
+				pos = json_lazy_skip_value(js, val_start, len);
+				if (pos == val_start)
+					goto fail;
+			}
+			if (pos < 0)
+				goto fail;
+			/* Everything needed is there, the rest of the document is not looked at */
+			if (found_keys == all_keys) {
+				obj_end = pos;
+				break;
+			}
+			pos = jsmn_skip_space(js, pos, len);
+			if ((pos < len) && (js[pos] == ',')) {
+				pos = jsmn_skip_space(js, pos + 1, len);
+				continue;
+			}
+			if ((pos < len) && (js[pos] == '}')) {
+				obj_end = pos + 1;
+				break;
+			}
+			goto fail;
+		}
+	}
+
+	tok = arena->tokens;
+	tok->type = JSMN_OBJECT;
+	tok->start = obj_start;
+	tok->end = obj_end;
+	tok->size = num_found;
+#ifdef JSMN_PARENT_LINKS
+	tok->parent = -1;
+#endif
+	tok->next = idx;
+	jctx->js = js;
+	jctx->tokens = arena->tokens;
+	jctx->num_tokens = idx;
+	jctx->tokens_borrowed = true;
+	jctx->cur = jctx->tokens;
+	return OS_SUCCESS;
+
+fail:
+	memset(jctx, 0, sizeof(jparse_ctx_t));
+	return -OS_FAIL;
+}
+
+int json_parse_start_lazy(jparse_ctx_t *jctx, char *js, int len, char **keys, int num_keys)
+{
+	json_tok_arena_t arena;
+	/* Sized for the keys and a few tokens for each of their values */
+	json_tok_arena_init(&arena, NULL, 1 + 4 * num_keys);
+	if (json_parse_start_lazy_arena(jctx, &arena, js, len, keys, num_keys) != OS_SUCCESS) {
+		json_tok_arena_free(&arena);
+		return -OS_FAIL;
+	}
+	/* The tokens are handed over, to be freed by json_parse_end() */
+	jctx->tokens_borrowed = false;
+	return OS_SUCCESS;
+}
+
+int json_obj_index_enable(jparse_ctx_t *jctx)
+{
+	if (!jctx->tokens)
+		return -OS_FAIL;
+	jctx->obj_index_enabled = true;
+	return OS_SUCCESS;
+}
+
 int json_parse_end(jparse_ctx_t *jctx)
 {
-	if (jctx->tokens)
+	while (jctx->obj_index) {
+		json_obj_index_t *next = jctx->obj_index->next;
+		free(jctx->obj_index);
+		jctx->obj_index = next;
+	}
+	if (jctx->tokens && !jctx->tokens_borrowed)
 		free(jctx->tokens);
 	memset(jctx, 0, sizeof(jparse_ctx_t));
 	return OS_SUCCESS;
@@ -0,0 +1,185 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <json_path.h>
+
+static int32_t json_path_index(const char *str, int len)
+{
+	/* Same as RFC 6901: no sign and no leading zeros */
+	if (len == 0 || len > 9 || (len > 1 && str[0] == '0'))
+		return -1;
+	int32_t index = 0;
+	for (int i = 0; i < len; i++) {
+		if (str[i] < '0' || str[i] > '9')
+			return -1;
+		index = index * 10 + (str[i] - '0');
+	}
+	return index;
+}
+
+int json_path_compile(json_path_t *path, const char *str)
+{
+	memset(path, 0, sizeof(json_path_t));
+	/* The empty path refers to the whole document */
+	if (*str == '\0')
+		return OS_SUCCESS;
+	if (*str != '/')
+		return -OS_FAIL;
+	int key_len = 0;
+	while (*str == '/') {
+		str++;
+		if (path->num_steps == JSON_PATH_MAX_STEPS)
+			return -OS_FAIL;
+		int start = key_len;
+		while (*str && *str != '/') {
+			char c = *str++;
+			if (c == '~') {
+				if (*str == '0')
+					c = '~';
+				else if (*str == '1')
+					c = '/';
+				else
+					return -OS_FAIL;
+				str++;
+			}
+			if (key_len == JSON_PATH_MAX_KEYS_LEN)
+				return -OS_FAIL;
+			path->keys[key_len++] = c;
+		}
+		path->steps[path->num_steps].key_offset = start;
+		path->steps[path->num_steps].key_len = key_len - start;
+		path->steps[path->num_steps].index = json_path_index(path->keys + start, key_len - start);
+		path->num_steps++;
+	}
+	return OS_SUCCESS;
+}
+
+static bool json_path_step_matches(jparse_ctx_t *jctx, const json_path_t *path, int depth,
+		json_tok_t *parent, json_tok_t *child, int n)
+{
+	if (parent->type == JSMN_ARRAY)
+		return path->steps[depth].index == n;
+	int len = path->steps[depth].key_len;
+	return ((child->end - child->start) == len)
+		&& (strncmp(jctx->js + child->start, path->keys + path->steps[depth].key_offset, len) == 0);
+}
+
+static void json_path_set_val(jparse_ctx_t *jctx, json_tok_t *tok, json_iter_t *val)
+{
+	memset(val, 0, sizeof(json_iter_t));
+	val->jctx = jctx;
+	val->elem = tok;
+	val->remaining = 1;
+}
+
+/* All the paths in active have matched the first depth steps, with tok being the
+ * value reached. Every child of tok is looked at once, for all the paths together.
+ */
+static uint32_t json_path_descend(jparse_ctx_t *jctx, json_tok_t *tok, int depth,
+		const json_path_t *paths, int num_paths, uint32_t active, json_iter_t *vals)
+{
+	uint32_t found = 0, pending = 0;
+	int i;
+	for (i = 0; i < num_paths; i++) {
+		if (!(active & (1u << i)))
+			continue;
+		if (paths[i].num_steps == depth) {
+			json_path_set_val(jctx, tok, &vals[i]);
+			found |= (1u << i);
+		} else {
+			pending |= (1u << i);
+		}
+	}
+	if ((tok->type != JSMN_OBJECT) && (tok->type != JSMN_ARRAY))
+		return found;
+	json_tok_t *child = tok + 1;
+	int n;
+	for (n = 0; (n < tok->size) && pending; n++) {
+		uint32_t match = 0;
+		for (i = 0; i < num_paths; i++) {
+			if ((pending & (1u << i)) && json_path_step_matches(jctx, &paths[i], depth, tok, child, n))
+				match |= (1u << i);
+		}
+		if (match) {
+			/* The first match wins, as with json_obj_get_*() */
+			pending &= ~match;
+			found |= json_path_descend(jctx, tok->type == JSMN_OBJECT ? child + 1 : child,
+					depth + 1, paths, num_paths, match, vals);
+		}
+		/* For object members, the key links to the next key */
+		if ((n + 1) < tok->size)
+			child = &jctx->tokens[child->next];
+	}
+	return found;
+}
+
+uint32_t json_path_find_multi(jparse_ctx_t *jctx, const json_path_t *paths, int num_paths,
+		json_iter_t *vals)
+{
+	if ((num_paths <= 0) || (num_paths > JSON_PATH_MAX_MULTI) || (jctx->num_tokens <= 0))
+		return 0;
+	uint32_t all = (num_paths == JSON_PATH_MAX_MULTI) ? 0xFFFFFFFFu : ((1u << num_paths) - 1);
+	return json_path_descend(jctx, &jctx->tokens[0], 0, paths, num_paths, all, vals);
+}
+
+int json_path_find(jparse_ctx_t *jctx, const json_path_t *path, json_iter_t *val)
+{
+	if (!json_path_find_multi(jctx, path, 1, val))
+		return -OS_FAIL;
+	return OS_SUCCESS;
+}
+
+int json_path_get_bool(jparse_ctx_t *jctx, const json_path_t *path, bool *val)
+{
+	json_iter_t it;
+	if (json_path_find(jctx, path, &it) != OS_SUCCESS)
+		return -OS_FAIL;
+	return json_iter_get_bool(&it, val);
+}
+
+int json_path_get_int(jparse_ctx_t *jctx, const json_path_t *path, int *val)
+{
+	json_iter_t it;
+	if (json_path_find(jctx, path, &it) != OS_SUCCESS)
+		return -OS_FAIL;
+	return json_iter_get_int(&it, val);
+}
+
+int json_path_get_int64(jparse_ctx_t *jctx, const json_path_t *path, int64_t *val)
+{
+	json_iter_t it;
+	if (json_path_find(jctx, path, &it) != OS_SUCCESS)
+		return -OS_FAIL;
+	return json_iter_get_int64(&it, val);
+}
+
+int json_path_get_float(jparse_ctx_t *jctx, const json_path_t *path, float *val)
+{
+	json_iter_t it;
+	if (json_path_find(jctx, path, &it) != OS_SUCCESS)
+		return -OS_FAIL;
+	return json_iter_get_float(&it, val);
+}
+
+int json_path_get_string(jparse_ctx_t *jctx, const json_path_t *path, char *val, int size)
+{
+	json_iter_t it;
+	if (json_path_find(jctx, path, &it) != OS_SUCCESS)
+		return -OS_FAIL;
+	return json_iter_get_string(&it, val, size);
+}
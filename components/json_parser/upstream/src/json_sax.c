@@ -0,0 +1,333 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <json_sax.h>
+
+enum {
+	SAX_STATE_VALUE,	/* Expecting a value */
+	SAX_STATE_ARR_FIRST,	/* After '[', expecting a value or ']' */
+	SAX_STATE_OBJ_FIRST,	/* After '{', expecting a key or '}' */
+	SAX_STATE_KEY,		/* After ',' in an object, expecting a key */
+	SAX_STATE_COLON,	/* After a key */
+	SAX_STATE_AFTER,	/* After a value, expecting ',' or the end of the container */
+	SAX_STATE_STRING,
+	SAX_STATE_STRING_ESC,	/* After a '\' in a string */
+	SAX_STATE_STRING_HEX,	/* Inside the XXXX of \uXXXX */
+	SAX_STATE_NUMBER,
+	SAX_STATE_LITERAL,
+	SAX_STATE_DONE,
+	SAX_STATE_ERROR,
+};
+
+static inline bool json_sax_is_space(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static inline bool json_sax_in_object(json_sax_ctx_t *ctx)
+{
+	int level = ctx->depth - 1;
+	return ctx->stack[level / 32] & (1u << (level % 32));
+}
+
+static bool json_sax_valid_number(const char *num, int len)
+{
+	int i = 0;
+	if (num[i] == '-')
+		i++;
+	if (i == len)
+		return false;
+	if (num[i] == '0') {
+		i++;
+	} else if (num[i] >= '1' && num[i] <= '9') {
+		while (i < len && num[i] >= '0' && num[i] <= '9')
+			i++;
+	} else {
+		return false;
+	}
+	if (i < len && num[i] == '.') {
+		int start = ++i;
+		while (i < len && num[i] >= '0' && num[i] <= '9')
+			i++;
+		if (i == start)
+			return false;
+	}
+	if (i < len && (num[i] == 'e' || num[i] == 'E')) {
+		i++;
+		if (i < len && (num[i] == '+' || num[i] == '-'))
+			i++;
+		int start = i;
+		while (i < len && num[i] >= '0' && num[i] <= '9')
+			i++;
+		if (i == start)
+			return false;
+	}
+	return i == len;
+}
+
+static int json_sax_emit(json_sax_ctx_t *ctx, json_sax_event_t event, const char *val,
+		int len, bool partial)
+{
+	if (ctx->cb(event, val, len, partial, ctx->priv) != OS_SUCCESS) {
+		ctx->state = SAX_STATE_ERROR;
+		return -OS_FAIL;
+	}
+	return OS_SUCCESS;
+}
+
+static void json_sax_value_done(json_sax_ctx_t *ctx)
+{
+	ctx->state = ctx->depth ? SAX_STATE_AFTER : SAX_STATE_DONE;
+}
+
+static int json_sax_push(json_sax_ctx_t *ctx, bool is_object)
+{
+	if (ctx->depth == JSON_SAX_MAX_DEPTH)
+		return -OS_FAIL;
+	if (is_object)
+		ctx->stack[ctx->depth / 32] |= (1u << (ctx->depth % 32));
+	else
+		ctx->stack[ctx->depth / 32] &= ~(1u << (ctx->depth % 32));
+	ctx->depth++;
+	ctx->state = is_object ? SAX_STATE_OBJ_FIRST : SAX_STATE_ARR_FIRST;
+	return json_sax_emit(ctx, is_object ? JSON_SAX_OBJECT_START : JSON_SAX_ARRAY_START,
+			NULL, 0, false);
+}
+
+static int json_sax_pop(json_sax_ctx_t *ctx, char c)
+{
+	bool is_object = (c == '}');
+	if (!ctx->depth || (json_sax_in_object(ctx) != is_object))
+		return -OS_FAIL;
+	ctx->depth--;
+	json_sax_value_done(ctx);
+	return json_sax_emit(ctx, is_object ? JSON_SAX_OBJECT_END : JSON_SAX_ARRAY_END,
+			NULL, 0, false);
+}
+
+static int json_sax_start_value(json_sax_ctx_t *ctx, char c)
+{
+	switch (c) {
+	case '{':
+	case '[':
+		return json_sax_push(ctx, c == '{');
+	case '"':
+		ctx->is_key = false;
+		ctx->state = SAX_STATE_STRING;
+		return OS_SUCCESS;
+	case 't':
+		ctx->literal = "true";
+		break;
+	case 'f':
+		ctx->literal = "false";
+		break;
+	case 'n':
+		ctx->literal = "null";
+		break;
+	default:
+		if (c == '-' || (c >= '0' && c <= '9')) {
+			ctx->scratch[0] = c;
+			ctx->scratch_len = 1;
+			ctx->state = SAX_STATE_NUMBER;
+			return OS_SUCCESS;
+		}
+		return -OS_FAIL;
+	}
+	ctx->pos = 1;
+	ctx->state = SAX_STATE_LITERAL;
+	return OS_SUCCESS;
+}
+
+static int json_sax_end_number(json_sax_ctx_t *ctx)
+{
+	if (!json_sax_valid_number(ctx->scratch, ctx->scratch_len))
+		return -OS_FAIL;
+	json_sax_value_done(ctx);
+	return json_sax_emit(ctx, JSON_SAX_NUMBER, ctx->scratch, ctx->scratch_len, false);
+}
+
+/* Consumes string bytes, starting at buf[i] up to and including the closing quote
+ * if it is in this chunk. Returns the index of the next unconsumed byte or -1.
+ */
+static int json_sax_scan_string(json_sax_ctx_t *ctx, const char *buf, int len, int i)
+{
+	int start = i;
+	for (; i < len; i++) {
+		char c = buf[i];
+		if (ctx->state == SAX_STATE_STRING) {
+			if (c == '"')
+				break;
+			if (c == '\\')
+				ctx->state = SAX_STATE_STRING_ESC;
+			else if ((uint8_t)c < 0x20)
+				return -1;
+		} else if (ctx->state == SAX_STATE_STRING_ESC) {
+			if (c == 'u') {
+				ctx->pos = 0;
+				ctx->state = SAX_STATE_STRING_HEX;
+			} else if (c && strchr("\"\\/bfnrt", c)) {
+				ctx->state = SAX_STATE_STRING;
+			} else {
+				return -1;
+			}
+		} else {
+			if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')))
+				return -1;
+			if (++ctx->pos == 4)
+				ctx->state = SAX_STATE_STRING;
+		}
+	}
+	bool done = (i < len);
+	if (ctx->is_key) {
+		if ((ctx->scratch_len + (i - start)) > JSON_SAX_MAX_KEY_LEN)
+			return -1;
+		memcpy(ctx->scratch + ctx->scratch_len, buf + start, i - start);
+		ctx->scratch_len += i - start;
+		if (done) {
+			ctx->state = SAX_STATE_COLON;
+			if (json_sax_emit(ctx, JSON_SAX_KEY, ctx->scratch, ctx->scratch_len, false) != OS_SUCCESS)
+				return -1;
+		}
+	} else if (done || (i > start)) {
+		if (done)
+			json_sax_value_done(ctx);
+		if (json_sax_emit(ctx, JSON_SAX_STRING, buf + start, i - start, !done) != OS_SUCCESS)
+			return -1;
+	}
+	return done ? i + 1 : i;
+}
+
+void json_sax_start(json_sax_ctx_t *ctx, json_sax_cb_t cb, void *priv)
+{
+	memset(ctx, 0, sizeof(json_sax_ctx_t));
+	ctx->cb = cb;
+	ctx->priv = priv;
+	ctx->state = SAX_STATE_VALUE;
+}
+
+int json_sax_feed(json_sax_ctx_t *ctx, const char *buf, int len)
+{
+	int i = 0;
+	while (i < len) {
+		char c = buf[i];
+		int ret = OS_SUCCESS;
+		switch (ctx->state) {
+		case SAX_STATE_STRING:
+		case SAX_STATE_STRING_ESC:
+		case SAX_STATE_STRING_HEX:
+			i = json_sax_scan_string(ctx, buf, len, i);
+			if (i < 0) {
+				ctx->state = SAX_STATE_ERROR;
+				return -OS_FAIL;
+			}
+			continue;
+		case SAX_STATE_NUMBER:
+			if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E'
+					|| c == '+' || c == '-') {
+				if (ctx->scratch_len == JSON_SAX_MAX_KEY_LEN) {
+					ret = -OS_FAIL;
+					break;
+				}
+				ctx->scratch[ctx->scratch_len++] = c;
+				break;
+			}
+			/* The terminating character is part of what follows the number */
+			if (json_sax_end_number(ctx) != OS_SUCCESS) {
+				ret = -OS_FAIL;
+				break;
+			}
+			continue;
+		case SAX_STATE_LITERAL:
+			if (c != ctx->literal[ctx->pos]) {
+				ret = -OS_FAIL;
+				break;
+			}
+			if (ctx->literal[++ctx->pos] == '\0') {
+				json_sax_value_done(ctx);
+				ret = json_sax_emit(ctx, ctx->literal[0] == 'n' ? JSON_SAX_NULL : JSON_SAX_BOOL,
+						ctx->literal, ctx->pos, false);
+			}
+			break;
+		case SAX_STATE_ERROR:
+			return -OS_FAIL;
+		default:
+			if (json_sax_is_space(c))
+				break;
+			switch (ctx->state) {
+			case SAX_STATE_ARR_FIRST:
+				if (c == ']') {
+					ret = json_sax_pop(ctx, c);
+					break;
+				}
+				/* Fall through */
+			case SAX_STATE_VALUE:
+				ret = json_sax_start_value(ctx, c);
+				break;
+			case SAX_STATE_OBJ_FIRST:
+				if (c == '}') {
+					ret = json_sax_pop(ctx, c);
+					break;
+				}
+				/* Fall through */
+			case SAX_STATE_KEY:
+				if (c != '"') {
+					ret = -OS_FAIL;
+					break;
+				}
+				ctx->is_key = true;
+				ctx->scratch_len = 0;
+				ctx->state = SAX_STATE_STRING;
+				break;
+			case SAX_STATE_COLON:
+				if (c == ':')
+					ctx->state = SAX_STATE_VALUE;
+				else
+					ret = -OS_FAIL;
+				break;
+			case SAX_STATE_AFTER:
+				if (c == ',')
+					ctx->state = json_sax_in_object(ctx) ? SAX_STATE_KEY : SAX_STATE_VALUE;
+				else if (c == '}' || c == ']')
+					ret = json_sax_pop(ctx, c);
+				else
+					ret = -OS_FAIL;
+				break;
+			default:
+				/* Only whitespace is allowed after the document */
+				ret = -OS_FAIL;
+				break;
+			}
+			break;
+		}
+		if (ret != OS_SUCCESS) {
+			ctx->state = SAX_STATE_ERROR;
+			return -OS_FAIL;
+		}
+		i++;
+	}
+	return OS_SUCCESS;
+}
+
+int json_sax_end(json_sax_ctx_t *ctx)
+{
+	/* A top level number has nothing after it to terminate it */
+	if ((ctx->state == SAX_STATE_NUMBER) && (ctx->depth == 0)
+			&& (json_sax_end_number(ctx) != OS_SUCCESS))
+		ctx->state = SAX_STATE_ERROR;
+	return (ctx->state == SAX_STATE_DONE) ? OS_SUCCESS : -OS_FAIL;
+}
@@ -0,0 +1,376 @@
+/*
+ *    Copyright 2020 Piyush Shah <shahpiyushv@gmail.com>
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/* Host benchmark. Build with "make bench", which links with --wrap for the
+ * allocator functions so that heap usage can be tracked.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <json_parser.h>
+#include <json_sax.h>
+#include <json_batch.h>
+
+#define BENCH_MIN_TIME_NS	200000000LL
+#define BENCH_MAX_TOKENS	8192
+#define BENCH_BATCH_DOCS	4096
+
+/* Every block gets a header with its size, so that frees can be accounted for */
+#define BENCH_HDR	16
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static long bench_allocs;
+static size_t bench_live, bench_peak;
+
+static void *bench_track(char *p, size_t size)
+{
+	if (!p)
+		return NULL;
+	*(size_t *)p = size;
+	/* The batch workers allocate their arenas concurrently */
+	__atomic_add_fetch(&bench_allocs, 1, __ATOMIC_RELAXED);
+	size_t live = __atomic_add_fetch(&bench_live, size, __ATOMIC_RELAXED);
+	if (live > bench_peak)
+		bench_peak = live;
+	return p + BENCH_HDR;
+}
+
+void *__wrap_malloc(size_t size)
+{
+	return bench_track(__real_malloc(size + BENCH_HDR), size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	return bench_track(__real_calloc(1, nmemb * size + BENCH_HDR), nmemb * size);
+}
+
+void __wrap_free(void *ptr)
+{
+	if (!ptr)
+		return;
+	char *p = (char *)ptr - BENCH_HDR;
+	__atomic_sub_fetch(&bench_live, *(size_t *)p, __ATOMIC_RELAXED);
+	__real_free(p);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	if (!ptr)
+		return __wrap_malloc(size);
+	char *p = (char *)ptr - BENCH_HDR;
+	size_t old = *(size_t *)p;
+	p = __real_realloc(p, size + BENCH_HDR);
+	if (!p)
+		return NULL;
+	__atomic_sub_fetch(&bench_live, old, __ATOMIC_RELAXED);
+	return bench_track(p, size);
+}
+
+typedef struct {
+	const char *name;
+	char *js;
+	int len;
+	int num_tokens;
+	/* Keys for json_parse_start_lazy() */
+	char *keys[2];
+	int num_keys;
+} bench_doc_t;
+
+typedef enum {
+	BENCH_PARSE_START,
+	BENCH_PARSE_STATIC,
+	BENCH_PARSE_ARENA,
+	BENCH_PARSE_LAZY,
+	BENCH_PARSE_LAZY_ARENA,
+	BENCH_SAX,
+	BENCH_MAX,
+} bench_api_t;
+
+static const char *bench_api_names[] = {
+	"json_parse_start",
+	"json_parse_start_static",
+	"json_parse_start_arena",
+	"json_parse_start_lazy",
+	"json_parse_start_lazy_arena",
+	"json_sax_feed",
+};
+
+static json_tok_t bench_tokens[BENCH_MAX_TOKENS];
+static json_tok_arena_t bench_arena;
+
+static char *bench_append(char *buf, int *len, int *size, const char *fmt, ...)
+{
+	va_list args;
+	while (1) {
+		va_start(args, fmt);
+		int n = vsnprintf(buf + *len, *size - *len, fmt, args);
+		va_end(args);
+		if (n < *size - *len) {
+			*len += n;
+			return buf;
+		}
+		*size *= 2;
+		buf = realloc(buf, *size);
+	}
+}
+
+static void bench_doc_claim_init(bench_doc_t *doc)
+{
+	int len = 0, size = 256;
+	char *buf = malloc(size);
+	buf = bench_append(buf, &len, &size, "{\"auth_id\":\"3f2c8a1e-7d4b-4c61-9a0e-5b7f1d2e8c93\",\"challenge\":\"");
+	for (int i = 0; i < 64; i++)
+		buf = bench_append(buf, &len, &size, "%02X", (i * 37 + 11) & 0xFF);
+	buf = bench_append(buf, &len, &size, "\"}");
+	doc->name = "claim init response";
+	doc->js = buf;
+	doc->len = len;
+	doc->keys[0] = "auth_id";
+	doc->keys[1] = "challenge";
+	doc->num_keys = 2;
+}
+
+static void bench_doc_claim_verify(bench_doc_t *doc)
+{
+	static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	int len = 0, size = 256;
+	char *buf = malloc(size);
+	buf = bench_append(buf, &len, &size, "{\"certificate\":\"-----BEGIN CERTIFICATE-----\\n");
+	for (int line = 0; line < 20; line++) {
+		for (int i = 0; i < 64; i++)
+			buf = bench_append(buf, &len, &size, "%c", b64[(line * 64 + i) * 7 % 64]);
+		buf = bench_append(buf, &len, &size, "\\n");
+	}
+	buf = bench_append(buf, &len, &size, "-----END CERTIFICATE-----\\n\",\"certificate_id\":\"a1b2c3\"}");
+	doc->name = "claim verify response";
+	doc->js = buf;
+	doc->len = len;
+	doc->keys[0] = "certificate";
+	doc->num_keys = 1;
+}
+
+static void bench_doc_shadow(bench_doc_t *doc)
+{
+	int len = 0, size = 1024;
+	char *buf = malloc(size);
+	buf = bench_append(buf, &len, &size, "{\n  \"state\": {\n    \"desired\": {\n      \"channels\": [\n");
+	for (int i = 0; i < 16; i++) {
+		buf = bench_append(buf, &len, &size,
+				"        {\n          \"id\": %d,\n          \"name\": \"channel %d\",\n"
+				"          \"rate_ms\": %d,\n          \"enabled\": %s,\n"
+				"          \"threshold\": %d.%02d\n        }%s\n",
+				i, i, 100 * (i + 1), (i & 1) ? "true" : "false", i * 3, i * 7 % 100,
+				(i == 15) ? "" : ",");
+	}
+	buf = bench_append(buf, &len, &size,
+			"      ],\n      \"config\": {\n        \"mode\": \"auto\",\n        \"interval\": 30,\n"
+			"        \"server\": \"mqtt.example.com\",\n        \"retries\": 5\n      }\n    },\n"
+			"    \"reported\": {\n      \"firmware\": \"1.4.2\",\n      \"uptime\": 123456,\n"
+			"      \"rssi\": -67,\n      \"heap\": 183224\n    }\n  },\n"
+			"  \"metadata\": {\n    \"desired\": {\n      \"config\": {\n"
+			"        \"mode\": {\n          \"timestamp\": 1600000000\n        }\n      }\n    }\n  },\n"
+			"  \"version\": 42,\n  \"timestamp\": 1600000123\n}");
+	doc->name = "shadow document";
+	doc->js = buf;
+	doc->len = len;
+	doc->keys[0] = "version";
+	doc->keys[1] = "timestamp";
+	doc->num_keys = 2;
+}
+
+static void bench_doc_numeric(bench_doc_t *doc)
+{
+	int len = 0, size = 1024;
+	char *buf = malloc(size);
+	buf = bench_append(buf, &len, &size, "{\"samples\":[");
+	for (int i = 0; i < 2000; i++)
+		buf = bench_append(buf, &len, &size, "%s%d.%03d", i ? "," : "", (i * 7919) % 1000 - 500, (i * 31) % 1000);
+	buf = bench_append(buf, &len, &size, "],\"ts\":[");
+	for (int i = 0; i < 1000; i++)
+		buf = bench_append(buf, &len, &size, "%s%d", i ? "," : "", 1600000000 + i * 10);
+	buf = bench_append(buf, &len, &size, "]}");
+	doc->name = "numeric arrays";
+	doc->js = buf;
+	doc->len = len;
+	doc->keys[0] = "ts";
+	doc->num_keys = 1;
+}
+
+static int bench_sax_cb(json_sax_event_t event, const char *val, int len, bool partial, void *priv)
+{
+	(void)event;
+	(void)val;
+	(void)len;
+	(void)partial;
+	(*(int *)priv)++;
+	return OS_SUCCESS;
+}
+
+static int bench_run_once(bench_doc_t *doc, bench_api_t api)
+{
+	jparse_ctx_t jctx;
+	int ret = -OS_FAIL;
+	switch (api) {
+	case BENCH_PARSE_START:
+		ret = json_parse_start(&jctx, doc->js, doc->len);
+		break;
+	case BENCH_PARSE_STATIC:
+		ret = json_parse_start_static(&jctx, doc->js, doc->len, bench_tokens, BENCH_MAX_TOKENS);
+		break;
+	case BENCH_PARSE_ARENA:
+		ret = json_parse_start_arena(&jctx, &bench_arena, doc->js, doc->len);
+		break;
+	case BENCH_PARSE_LAZY:
+		ret = json_parse_start_lazy(&jctx, doc->js, doc->len, doc->keys, doc->num_keys);
+		break;
+	case BENCH_PARSE_LAZY_ARENA:
+		ret = json_parse_start_lazy_arena(&jctx, &bench_arena, doc->js, doc->len, doc->keys,
+				doc->num_keys);
+		break;
+	case BENCH_SAX: {
+		json_sax_ctx_t sax;
+		int events = 0;
+		json_sax_start(&sax, bench_sax_cb, &events);
+		if (json_sax_feed(&sax, doc->js, doc->len) != OS_SUCCESS)
+			return -OS_FAIL;
+		return json_sax_end(&sax);
+	}
+	default:
+		return -OS_FAIL;
+	}
+	if (ret == OS_SUCCESS)
+		json_parse_end(&jctx);
+	return ret;
+}
+
+static long long bench_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void bench_run(bench_doc_t *doc, bench_api_t api)
+{
+	/* One untimed run, to warm up the arena and measure the heap */
+	size_t base = bench_live;
+	bench_peak = bench_live;
+	bench_allocs = 0;
+	if (bench_run_once(doc, api) != OS_SUCCESS) {
+		printf("  %-28s failed\n", bench_api_names[api]);
+		return;
+	}
+	size_t peak = bench_peak - base;
+
+	long long start = bench_now_ns(), elapsed;
+	long iterations = 0, batch = 16;
+	bench_allocs = 0;
+	do {
+		for (long i = 0; i < batch; i++)
+			bench_run_once(doc, api);
+		iterations += batch;
+		batch *= 2;
+		elapsed = bench_now_ns() - start;
+	} while (elapsed < BENCH_MIN_TIME_NS);
+
+	double ns = (double)elapsed / iterations;
+	printf("  %-28s %9.1f MB/s %8.2f ns/token %8zu B peak heap %6.2f allocs\n",
+			bench_api_names[api], (doc->len * 1000.0) / ns, ns / doc->num_tokens,
+			peak, (double)bench_allocs / iterations);
+}
+
+static int bench_batch_cb(jparse_ctx_t *jctx, int index, void *priv)
+{
+	if (!jctx)
+		return -OS_FAIL;
+	((int *)priv)[index] = jctx->num_tokens;
+	return OS_SUCCESS;
+}
+
+/* Parses a batch made of copies of the corpus with 1, 2, 4... threads up to the number of CPUs */
+static void bench_batch(bench_doc_t *docs, int num_docs)
+{
+	json_batch_doc_t *batch = malloc(BENCH_BATCH_DOCS * sizeof(json_batch_doc_t));
+	int *results = malloc(BENCH_BATCH_DOCS * sizeof(int));
+	long long bytes = 0;
+	for (int i = 0; i < BENCH_BATCH_DOCS; i++) {
+		batch[i].js = docs[i % num_docs].js;
+		batch[i].len = docs[i % num_docs].len;
+		bytes += batch[i].len;
+	}
+	int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	printf("batch of %d documents:\n", BENCH_BATCH_DOCS);
+	for (int threads = 1; ; threads *= 2) {
+		if (threads > max_threads)
+			threads = max_threads;
+		long long start = bench_now_ns(), elapsed;
+		int rounds = 0;
+		do {
+			if (json_batch_parse(batch, BENCH_BATCH_DOCS, threads, bench_batch_cb, results) != OS_SUCCESS) {
+				printf("  json_batch_parse failed\n");
+				goto out;
+			}
+			rounds++;
+			elapsed = bench_now_ns() - start;
+		} while (elapsed < BENCH_MIN_TIME_NS);
+		printf("  json_batch_parse %3d threads %9.1f MB/s\n", threads,
+				(bytes * rounds * 1000.0) / elapsed);
+		if (threads == max_threads)
+			break;
+	}
+out:
+	free(results);
+	free(batch);
+}
+
+int main(void)
+{
+	bench_doc_t docs[4];
+	bench_doc_claim_init(&docs[0]);
+	bench_doc_claim_verify(&docs[1]);
+	bench_doc_shadow(&docs[2]);
+	bench_doc_numeric(&docs[3]);
+
+	json_tok_arena_init(&bench_arena, NULL, 0);
+	printf("sizeof(json_tok_t) = %zu\n", sizeof(json_tok_t));
+	for (size_t d = 0; d < sizeof(docs) / sizeof(docs[0]); d++) {
+		bench_doc_t *doc = &docs[d];
+		jparse_ctx_t jctx;
+		if (json_parse_start(&jctx, doc->js, doc->len) != OS_SUCCESS) {
+			printf("%s: invalid document\n", doc->name);
+			return -1;
+		}
+		doc->num_tokens = jctx.num_tokens;
+		json_parse_end(&jctx);
+		printf("%s: %d bytes, %d tokens, %zu bytes of tokens\n", doc->name, doc->len,
+				doc->num_tokens, doc->num_tokens * sizeof(json_tok_t));
+		for (int api = 0; api < BENCH_MAX; api++)
+			bench_run(doc, api);
+	}
+	json_tok_arena_free(&bench_arena);
+	bench_batch(docs, sizeof(docs) / sizeof(docs[0]));
+	for (size_t d = 0; d < sizeof(docs) / sizeof(docs[0]); d++)
+		free(docs[d].js);
+	return 0;
+}
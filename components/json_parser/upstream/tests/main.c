@@ -17,6 +17,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <json_parser.h>
+#include <json_sax.h>
+#include <json_path.h>
+#include <cbor_parser.h>
 
 #define json_test_str	"{\n\"str_val\" :    \"JSON Parser\",\n" \
 			"\t\"float_val\" : 2.0,\n" \
@@ -29,6 +32,47 @@
 			"\"arrays\":\"yes\"},\n"\
 			"\"int_64\":109174583252}"
 
+/* Similar to json_test_str, in CBOR, with an indefinite length string and array */
+static const uint8_t cbor_test_buf[] = {
+	0xbf,										/* { (indefinite) */
+	0x67, 's', 't', 'r', '_', 'v', 'a', 'l',
+	0x7f, 0x65, 'C', 'B', 'O', 'R', ' ', 0x66, 'P', 'a', 'r', 's', 'e', 'r', 0xff,
+	0x69, 'f', 'l', 'o', 'a', 't', '_', 'v', 'a', 'l', 0xf9, 0x40, 0x00,	/* 2.0 (half) */
+	0x67, 'i', 'n', 't', '_', 'v', 'a', 'l', 0x19, 0x07, 0xe1,		/* 2017 */
+	0x6c, 's', 'u', 'p', 'p', 'o', 'r', 't', 'e', 'd', '_', 'e', 'l',
+	0x9f, 0x64, 'b', 'o', 'o', 'l', 0x63, 'i', 'n', 't', 0x65, 'f', 'l', 'o', 'a', 't', 0xff,
+	0x68, 'f', 'e', 'a', 't', 'u', 'r', 'e', 's',
+	0xa1, 0x67, 'o', 'b', 'j', 'e', 'c', 't', 's', 0xf5,
+	0x66, 'i', 'n', 't', '_', '6', '4', 0x1b, 0x00, 0x00, 0x00, 0x19, 0x6b, 0x4f, 0xef, 0xd4,
+	0x67, 's', 'a', 'm', 'p', 'l', 'e', 's',
+	0x83, 0xf9, 0x3e, 0x00, 0x02, 0xfa, 0x3d, 0xcc, 0xcc, 0xcd,		/* [1.5, 2, 0.1] */
+	0xff,
+};
+
+typedef struct {
+	int num_events;
+	bool in_str_val;
+	char str_val[64];
+	int str_val_len;
+} sax_test_t;
+
+static int sax_cb(json_sax_event_t event, const char *val, int len, bool partial, void *priv)
+{
+	sax_test_t *test = (sax_test_t *)priv;
+	test->num_events++;
+	if (event == JSON_SAX_KEY) {
+		test->in_str_val = (len == strlen("str_val")) && (strncmp(val, "str_val", len) == 0);
+	} else if ((event == JSON_SAX_STRING) && test->in_str_val) {
+		/* The value may arrive in pieces */
+		if (test->str_val_len + len >= sizeof(test->str_val))
+			return -OS_FAIL;
+		memcpy(test->str_val + test->str_val_len, val, len);
+		test->str_val_len += len;
+		test->str_val[test->str_val_len] = '\0';
+	}
+	return OS_SUCCESS;
+}
+
 int main(int argc, char **argv)
 {
 	jparse_ctx_t jctx;
@@ -75,7 +119,235 @@ int main(int argc, char **argv)
 	if (json_obj_get_int64(&jctx, "int_64", &int64_val) == OS_SUCCESS)
 		printf("int64_val %lld\n", int64_val);
 
+
+	/* Walk all members with iterators, descending into arrays and objects */
+	json_iter_t it, child;
+	for (json_iter_begin(&jctx, &it); !json_iter_end(&it); json_iter_next(&it)) {
+		char *key;
+		int key_len;
+		json_iter_get_key(&it, &key, &key_len);
+		if (json_iter_begin_child(&it, &child) == OS_SUCCESS) {
+			int cnt = 0;
+			for (; !json_iter_end(&child); json_iter_next(&child))
+				cnt++;
+			printf("iter %.*s: %d children\n", key_len, key, cnt);
+		}
+	}
+
+	/* Look up several compiled paths together, in one pass over the document */
+	json_path_t paths[3];
+	json_iter_t vals[3];
+	json_path_compile(&paths[0], "/supported_el/3");
+	json_path_compile(&paths[1], "/features/arrays");
+	json_path_compile(&paths[2], "/int_val");
+	uint32_t found = json_path_find_multi(&jctx, paths, 3, vals);
+	if (found == 0x7) {
+		json_iter_get_string(&vals[0], str_val, sizeof(str_val));
+		printf("path /supported_el/3: %s\n", str_val);
+		json_iter_get_string(&vals[1], str_val, sizeof(str_val));
+		printf("path /features/arrays: %s\n", str_val);
+		json_iter_get_int(&vals[2], &int_val);
+		printf("path /int_val: %d\n", int_val);
+	}
 	json_parse_end(&jctx);
+
+	/* Parse again, tokenizing just once into caller owned token storage */
+	json_tok_t tokens[32];
+	if (json_parse_start_static(&jctx, json_test_str, strlen(json_test_str),
+				tokens, sizeof(tokens) / sizeof(tokens[0])) == OS_SUCCESS) {
+		printf("Static parse: %d tokens\n", jctx.num_tokens);
+		json_parse_end(&jctx);
+	}
+
+	/* A growable arena starting too small grows while parsing and is then reused */
+	json_tok_arena_t arena;
+	json_tok_arena_init(&arena, NULL, 4);
+	int i;
+	for (i = 0; i < 2; i++) {
+		if (json_parse_start_arena(&jctx, &arena, json_test_str, strlen(json_test_str)) == OS_SUCCESS) {
+			printf("Arena parse: %d tokens, arena size %d\n", jctx.num_tokens, arena.num_tokens);
+			json_parse_end(&jctx);
+		}
+	}
+	json_tok_arena_free(&arena);
+
+	/* Tokenize only what is needed, stopping once both keys are found */
+	char *lazy_keys[] = {"features", "int_val"};
+	if (json_parse_start_lazy(&jctx, json_test_str, strlen(json_test_str), lazy_keys, 2) == OS_SUCCESS) {
+		printf("Lazy parse: %d tokens\n", jctx.num_tokens);
+		if (json_obj_get_int(&jctx, "int_val", &int_val) == OS_SUCCESS)
+			printf("lazy int_val %d\n", int_val);
+		json_parse_end(&jctx);
+	}
+
+	/* The same into caller owned tokens, for a string and an array */
+	char *lazy_arena_keys[] = {"supported_el", "str_val"};
+	json_tok_arena_init(&arena, tokens, sizeof(tokens) / sizeof(tokens[0]));
+	if (json_parse_start_lazy_arena(&jctx, &arena, json_test_str, strlen(json_test_str),
+				lazy_arena_keys, 2) == OS_SUCCESS) {
+		printf("Lazy arena parse: %d tokens\n", jctx.num_tokens);
+		if (json_obj_get_string(&jctx, "str_val", str_val, sizeof(str_val)) == OS_SUCCESS)
+			printf("lazy str_val %s\n", str_val);
+		if (json_obj_get_array(&jctx, "supported_el", &num_elem) == OS_SUCCESS) {
+			printf("lazy supported_el %d elements\n", num_elem);
+			json_obj_leave_array(&jctx);
+		}
+		json_parse_end(&jctx);
+	}
+
+	/* Whole arrays of numbers. Too many elements or a non number fail the whole call */
+	const char *arr_str = "{\"ints\":[1,-2,30000],\"big\":[9007199254740993,-5],"
+			"\"floats\":[0.5,-1.25,1e3],\"mixed\":[1,\"2\",3],\"nested\":[1,[2],3],"
+			"\"rows\":[[1,2],[3,4,5]]}";
+	if (json_parse_start(&jctx, (char *)arr_str, strlen(arr_str)) == OS_SUCCESS) {
+		int ints[4];
+		int64_t int64s[2];
+		float floats[3];
+		if (json_obj_get_int_array(&jctx, "ints", ints, 4, &num_elem) == OS_SUCCESS)
+			printf("ints %d: %d %d %d\n", num_elem, ints[0], ints[1], ints[2]);
+		if (json_obj_get_int_array(&jctx, "ints", ints, 2, &num_elem) != OS_SUCCESS)
+			printf("ints rejected with max_elem 2\n");
+		if (json_obj_get_int_array(&jctx, "big", ints, 4, &num_elem) != OS_SUCCESS)
+			printf("big rejected as int\n");
+		if (json_obj_get_int64_array(&jctx, "big", int64s, 2, &num_elem) == OS_SUCCESS)
+			printf("big %d: %lld %lld\n", num_elem, (long long)int64s[0], (long long)int64s[1]);
+		if (json_obj_get_float_array(&jctx, "floats", floats, 3, &num_elem) == OS_SUCCESS)
+			printf("floats %d: %g %g %g\n", num_elem, floats[0], floats[1], floats[2]);
+		if (json_obj_get_int_array(&jctx, "mixed", ints, 4, &num_elem) != OS_SUCCESS)
+			printf("mixed rejected\n");
+		if (json_obj_get_float_array(&jctx, "nested", floats, 3, &num_elem) != OS_SUCCESS)
+			printf("nested rejected\n");
+		if (json_obj_get_array(&jctx, "rows", &num_elem) == OS_SUCCESS) {
+			if (json_arr_get_int_array(&jctx, 1, ints, 4, &num_elem) == OS_SUCCESS)
+				printf("rows/1 %d: %d %d %d\n", num_elem, ints[0], ints[1], ints[2]);
+			json_obj_leave_array(&jctx);
+		}
+		json_parse_end(&jctx);
+	}
+
+	/* Numbers are range checked rather than truncated, and fixed point values are rounded */
+	const char *num_str = "{\"max\":2147483647,\"min\":-2147483648,\"over\":2147483648,"
+			"\"under\":-2147483649,\"temp\":23.456,\"neg\":-0.005,\"exp\":1.5e-1,"
+			"\"huge\":21474836.48}";
+	if (json_parse_start(&jctx, (char *)num_str, strlen(num_str)) == OS_SUCCESS) {
+		int32_t fixed;
+		if (json_obj_get_int(&jctx, "max", &int_val) == OS_SUCCESS)
+			printf("max %d\n", int_val);
+		if (json_obj_get_int(&jctx, "min", &int_val) == OS_SUCCESS)
+			printf("min %d\n", int_val);
+		if (json_obj_get_int(&jctx, "over", &int_val) != OS_SUCCESS
+				&& json_obj_get_int64(&jctx, "over", &int64_val) == OS_SUCCESS)
+			printf("over rejected as int, int64 %lld\n", (long long)int64_val);
+		if (json_obj_get_int(&jctx, "under", &int_val) != OS_SUCCESS)
+			printf("under rejected as int\n");
+		if (json_obj_get_fixed(&jctx, "temp", 2, &fixed) == OS_SUCCESS)
+			printf("temp fixed %d\n", (int)fixed);
+		if (json_obj_get_fixed(&jctx, "neg", 2, &fixed) == OS_SUCCESS)
+			printf("neg fixed %d\n", (int)fixed);
+		if (json_obj_get_fixed(&jctx, "exp", 3, &fixed) == OS_SUCCESS)
+			printf("exp fixed %d\n", (int)fixed);
+		if (json_obj_get_fixed(&jctx, "huge", 2, &fixed) != OS_SUCCESS)
+			printf("huge rejected as fixed\n");
+		json_parse_end(&jctx);
+	}
+
+	/* Floats which a single float or double operation cannot round correctly: halfway
+	 * and just past halfway between two floats, subnormals, the overflow boundary and
+	 * more digits than fit in 64 bits. Printed in hex, as they are exact.
+	 */
+	const char *float_str = "{\"floats\":[1.000000059604644775390625,1.00000005960464477539062500001,"
+			"7.006492321624086e-46,1.4e-45,1.17549421e-38,3.4028235677973366e38,3.4028236e38,"
+			"123456789012345678901234567890e-20]}";
+	if (json_parse_start(&jctx, (char *)float_str, strlen(float_str)) == OS_SUCCESS) {
+		float floats[8];
+		if (json_obj_get_float_array(&jctx, "floats", floats, 8, &num_elem) == OS_SUCCESS) {
+			printf("Hard floats:");
+			for (i = 0; i < num_elem; i++)
+				printf(" %a", floats[i]);
+			printf("\n");
+		}
+		json_parse_end(&jctx);
+	}
+
+	/* Key lookups give the same results with and without the hashed index. Sibling
+	 * objects have the same keys and the top level object has a duplicate key.
+	 */
+	const char *index_str = "{\"a\":{\"k0\":0,\"k1\":1,\"k2\":2,\"k3\":3,\"k4\":4,\"k5\":5,\"k6\":6,\"k7\":7,\"k8\":8},"
+			"\"b\":{\"k0\":10,\"k1\":11,\"k2\":12,\"k3\":13,\"k4\":14,\"k5\":15,\"k6\":16,\"k7\":17,\"k8\":18},"
+			"\"k1\":21,\"k2\":22,\"k3\":23,\"k4\":24,\"k5\":25,\"k6\":26,\"k7\":27,\"k8\":28,\"k7\":99}";
+	for (i = 0; i < 2; i++) {
+		if (json_parse_start(&jctx, (char *)index_str, strlen(index_str)) != OS_SUCCESS)
+			break;
+		if (i == 1 && json_obj_index_enable(&jctx) != OS_SUCCESS)
+			printf("Index could not be enabled\n");
+		int k7 = -1, k8 = -1, a_k8 = -1, b_k0 = -1, b_k8 = -1;
+		json_obj_get_int(&jctx, "k7", &k7);
+		json_obj_get_int(&jctx, "k8", &k8);
+		if (json_obj_get_object(&jctx, "a") == OS_SUCCESS) {
+			json_obj_get_int(&jctx, "k8", &a_k8);
+			json_obj_leave_object(&jctx);
+		}
+		if (json_obj_get_object(&jctx, "b") == OS_SUCCESS) {
+			json_obj_get_int(&jctx, "k0", &b_k0);
+			json_obj_get_int(&jctx, "k8", &b_k8);
+			json_obj_leave_object(&jctx);
+		}
+		bool missing = json_obj_get_int(&jctx, "k0", &int_val) != OS_SUCCESS;
+		printf("Index %s: k7 %d k8 %d a/k8 %d b/k0 %d b/k8 %d k0 %s\n", i ? "on" : "off",
+				k7, k8, a_k8, b_k0, b_k8, missing ? "missing" : "found");
+		json_parse_end(&jctx);
+	}
+
+	/* Decode escapes without copying. This writes to the buffer, so it cannot be a literal */
+	char esc_buf[] = "{\"cert\":\"line1\\nline2 \\u00e9\\ud83d\\ude00\"}";
+	if (json_parse_start(&jctx, esc_buf, strlen(esc_buf)) == OS_SUCCESS) {
+		char *view;
+		int view_len;
+		if (json_obj_get_strview(&jctx, "cert", &view, &view_len) == OS_SUCCESS)
+			printf("strview cert: %d bytes\n", view_len);
+		if (json_obj_get_string_inplace(&jctx, "cert", &view, &view_len) == OS_SUCCESS)
+			printf("inplace cert: %d bytes\n%s\n", view_len, view);
+		json_parse_end(&jctx);
+	}
+
+	/* Stream the document, one byte at a time */
+	json_sax_ctx_t sax;
+	sax_test_t sax_test = {0};
+	json_sax_start(&sax, sax_cb, &sax_test);
+	for (i = 0; i < strlen(json_test_str); i++) {
+		if (json_sax_feed(&sax, json_test_str + i, 1) != OS_SUCCESS)
+			break;
+	}
+	if (json_sax_end(&sax) == OS_SUCCESS)
+		printf("SAX parse: %d events, str_val %s\n", sax_test.num_events, sax_test.str_val);
+
+	/* The CBOR parser has the same accessors */
+	cbor_parse_ctx_t cctx;
+	if (cbor_parse_start(&cctx, cbor_test_buf, sizeof(cbor_test_buf)) == OS_SUCCESS) {
+		float samples[4];
+		if (cbor_obj_get_string(&cctx, "str_val", str_val, sizeof(str_val)) == OS_SUCCESS)
+			printf("cbor str_val %s\n", str_val);
+		if (cbor_obj_get_float(&cctx, "float_val", &float_val) == OS_SUCCESS)
+			printf("cbor float_val %f\n", float_val);
+		if (cbor_obj_get_int(&cctx, "int_val", &int_val) == OS_SUCCESS)
+			printf("cbor int_val %d\n", int_val);
+		if (cbor_obj_get_array(&cctx, "supported_el", &num_elem) == OS_SUCCESS) {
+			printf("cbor Array has %d elements\n", num_elem);
+			if (cbor_arr_get_string(&cctx, num_elem - 1, str_val, sizeof(str_val)) == OS_SUCCESS)
+				printf("cbor index %d: %s\n", num_elem - 1, str_val);
+			cbor_obj_leave_array(&cctx);
+		}
+		if (cbor_obj_get_object(&cctx, "features") == OS_SUCCESS) {
+			if (cbor_obj_get_bool(&cctx, "objects", &bool_val) == OS_SUCCESS)
+				printf("cbor objects %s\n", bool_val ? "true" : "false");
+			cbor_obj_leave_object(&cctx);
+		}
+		if (cbor_obj_get_int64(&cctx, "int_64", &int64_val) == OS_SUCCESS)
+			printf("cbor int64_val %lld\n", (long long)int64_val);
+		if (cbor_obj_get_float_array(&cctx, "samples", samples, 4, &num_elem) == OS_SUCCESS)
+			printf("cbor samples %f %f %f\n", samples[0], samples[1], samples[2]);
+		cbor_parse_end(&cctx);
+	}
 	return 0;
 
 }
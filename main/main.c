@@ -56,6 +56,9 @@
 /* Self-claiming  */
 #include "esp_rmaker_claim.h"
 
+/* JSON payload templates */
+#include "json_generator.h"
+
 /* Definitions ****************************************************************/
 
 /* JSON sending task */
@@ -63,7 +66,8 @@
 
 /* Buffer sizes  */
 #define THING_NAME_SIZE                      ( 60U )
-#define SEND_BUFFER_SIZE                     ( 1024U )
+#define PAYLOAD_SCRATCH_SIZE                 ( 128U )
+#define PAYLOAD_IOV_COUNT                    ( 16U )
 #define ETH_MAC_BUFFER_SIZE                  ( 6U )
 
 /* Task configs */
@@ -765,10 +769,16 @@ static void prvQuickConnectSendingTask(void* pvParameters)
     
     MQTTStatus_t eRet;
 
-    char pcSendBuffer[SEND_BUFFER_SIZE];
+    char pcValueScratch[PAYLOAD_SCRATCH_SIZE];
+    json_gen_iov_t pxPayloadIov[PAYLOAD_IOV_COUNT];
 
     float xTsensOut;
 
+    json_gen_template_t xPayloadTemplate;
+    json_gen_str_t xPayload;
+    int iRet;
+    int iIovCnt;
+
     /* Initialize temperature sensor. */
     temp_sensor_config_t xTsensConfig = TSENS_CONFIG_DEFAULT();
     temp_sensor_get_config(&xTsensConfig);
@@ -776,21 +786,12 @@ static void prvQuickConnectSendingTask(void* pvParameters)
     temp_sensor_set_config(xTsensConfig);
     temp_sensor_start();
 
-    while (1) 
-    {
-        /* Suspends the task for SENDING_INTERVAL_MS milliseconds. */
-        vTaskDelay(SENDING_INTERVAL_MS / portTICK_RATE_MS);
-
-        /* Wait for device to be connected to MQTT. */
-        xEventGroupWaitBits(xNetworkEventGroup, MQTT_CONNECTED_BIT, pdFALSE,
-            pdTRUE, portMAX_DELAY);
-
-        temp_sensor_read_celsius(&xTsensOut);
-
 /* ADD GRAPHS HERE ************************************************************/
+/* The template is compiled just once here. The loop below only formats the
+ * values, and the rest of the payload gets sent straight from the skeleton. */
 #define CUSTOM_GRAPH_ENABLED 0
 #if !CUSTOM_GRAPH_ENABLED
-        snprintf(pcSendBuffer, SEND_BUFFER_SIZE, 
+    iRet = json_gen_template_compile(&xPayloadTemplate,
             "["
                 "{"
                     "\"label\" : \"Temperature\","
@@ -799,14 +800,14 @@ static void prvQuickConnectSendingTask(void* pvParameters)
                     "["
                         "{"
                             "\"unit\" : \"Celsius\","
-                            "\"value\" : %f,"
+                            "\"value\" : %11.6f,"
                             "\"label\" : \"\""
                         "}"
                     "]"
                 "}"
-            "]", xTsensOut);
+            "]");
 #else
-        snprintf(pcSendBuffer, SEND_BUFFER_SIZE, 
+    iRet = json_gen_template_compile(&xPayloadTemplate,
             "["
                 "{"
                     "\"label\" : \"Temperature\","
@@ -815,7 +816,7 @@ static void prvQuickConnectSendingTask(void* pvParameters)
                     "["
                         "{"
                             "\"unit\" : \"Celsius\","
-                            "\"value\" : %f,"
+                            "\"value\" : %11.6f,"
                             "\"label\" : \"\""
                         "}"
                     "]"
@@ -827,19 +828,55 @@ static void prvQuickConnectSendingTask(void* pvParameters)
                     "["
                         "{"
                             "\"unit\" : \"Number\","
-                            "\"value\" : %d,"
+                            "\"value\" : %4d,"
                             "\"label\" : \"\""
                         "}"
                     "]"
                 "}"
-            "]", xTsensOut, rand() % 4000);
+            "]");
 #endif
 
 /******************************************************************************/
 
+    if (iRet != 0)
+    {
+        ESP_LOGE(TAG, "Could not compile the payload template.");
+        vTaskDelete(NULL);
+    }
+
+    while (1) 
+    {
+        /* Suspends the task for SENDING_INTERVAL_MS milliseconds. */
+        vTaskDelay(SENDING_INTERVAL_MS / portTICK_RATE_MS);
+
+        /* Wait for device to be connected to MQTT. */
+        xEventGroupWaitBits(xNetworkEventGroup, MQTT_CONNECTED_BIT, pdFALSE,
+            pdTRUE, portMAX_DELAY);
+
+        temp_sensor_read_celsius(&xTsensOut);
+
+        /* Only the values are written to the scratch buffer. The payload is
+         * a list of segments, most of them pointing into the skeleton. */
+        json_gen_str_start_iov(&xPayload, pxPayloadIov, PAYLOAD_IOV_COUNT,
+            pcValueScratch, PAYLOAD_SCRATCH_SIZE, NULL, NULL);
+#if !CUSTOM_GRAPH_ENABLED
+        iRet = json_gen_template_add(&xPayload, &xPayloadTemplate, xTsensOut);
+#else
+        iRet = json_gen_template_add(&xPayload, &xPayloadTemplate, xTsensOut,
+            rand() % 4000);
+#endif
+        iIovCnt = json_gen_get_iov_count(&xPayload);
+        json_gen_str_end(&xPayload);
+
+        if (iRet != 0)
+        {
+            ESP_LOGE(TAG, "Could not generate the payload.");
+            continue;
+        }
+
         /* Send JSON over MQTT connection. */
-        eRet = eMqttPublishQuickConnect(&xMQTTContext, pcThingName, 
-            pcSendBuffer);
+        eRet = eMqttPublishQuickConnectv(&xMQTTContext, pcThingName,
+            pxPayloadIov, iIovCnt);
 
         /* If it was not a success, then the connection was dropped. */
         if (eRet != MQTTSuccess)
@@ -50,6 +50,11 @@
 #define WIFI_CONFIG_SSID_BUFFER_SIZE ( 32U )
 #define WIFI_CONFIG_PASS_BUFFER_SIZE ( 64U )
 
+/* Default of coreMQTT releases which still have it */
+#ifndef MQTT_SEND_RETRY_TIMEOUT_MS
+#define MQTT_SEND_RETRY_TIMEOUT_MS   ( 10U )
+#endif
+
 /* Globals ********************************************************************/
 
 /* Logging tag */
@@ -57,7 +62,6 @@ static const char* TAG = "QuickConnectNetworking";
 
 /* MQTT */
 static uint32_t ulGlobalEntryTimeMs;
-static uint16_t usPublishPacketIdentifier;
 static uint8_t ucSharedBuffer[MQTT_SHARED_BUFFER_SIZE];
 static MQTTFixedBuffer_t xBuffer =
 {
@@ -181,9 +185,6 @@ static void prvMqttEventCallback(MQTTContext_t* pxMQTTContext,
     {
     case MQTT_PACKET_TYPE_PUBACK:
         ESP_LOGI(TAG,"PUBACK received for packet Id %u.", usPacketId);
-        /* Make sure ACK packet identifier matches with Request packet 
-         * identifier. */
-        assert(usPublishPacketIdentifier == usPacketId);
         break;
 
     case MQTT_PACKET_TYPE_SUBACK:
@@ -264,34 +265,137 @@ MQTTStatus_t eMqttConnect(MQTTContext_t* pxMQTTContext, const char* thingName)
     return xResult;
 }
 
-MQTTStatus_t eMqttPublishQuickConnect(MQTTContext_t* pxMQTTContext, 
-    const char* pcThingName,
-    const char* pcSendBuffer)
+/* Sends all of the data, since the transport may send less than asked for.
+ * As in coreMQTT, a send of 0 bytes means that it would block and is retried
+ * until nothing has been sent for MQTT_SEND_RETRY_TIMEOUT_MS. Only a negative
+ * return is an error right away. */
+static MQTTStatus_t prvMqttSendAll(MQTTContext_t* pxMQTTContext,
+    const void* pvData, size_t uxDataLen)
+{
+    TransportInterface_t* pxTransport = &pxMQTTContext->transportInterface;
+    const uint8_t* pucData = pvData;
+    uint32_t ulLastSendTimeMs = pxMQTTContext->getTime();
+    int32_t lBytesSent;
+
+    while (uxDataLen > 0)
+    {
+        lBytesSent = pxTransport->send(pxTransport->pNetworkContext, pucData,
+            uxDataLen);
+
+        if (lBytesSent < 0)
+        {
+            return MQTTSendFailed;
+        }
+
+        if (lBytesSent > 0)
+        {
+            pucData += lBytesSent;
+            uxDataLen -= lBytesSent;
+            ulLastSendTimeMs = pxMQTTContext->getTime();
+        }
+        else if ((pxMQTTContext->getTime() - ulLastSendTimeMs) >
+            MQTT_SEND_RETRY_TIMEOUT_MS)
+        {
+            return MQTTSendFailed;
+        }
+    }
+
+    return MQTTSuccess;
+}
+
+/* ESP-TLS has no vectored write, and every write becomes a TLS record of its
+ * own. So the segments are gathered after the header in the MQTT network
+ * buffer and sent whenever it fills up, while segments at least as large as
+ * the buffer are sent from where they are. */
+static MQTTStatus_t prvMqttSendv(MQTTContext_t* pxMQTTContext,
+    size_t uxHeaderSize, const json_gen_iov_t* pxIov, int iIovCnt)
+{
+    uint8_t* pucStaging = pxMQTTContext->networkBuffer.pBuffer;
+    size_t uxStagingSize = pxMQTTContext->networkBuffer.size;
+    size_t uxUsed = uxHeaderSize;
+    MQTTStatus_t xResult = MQTTSuccess;
+    int i;
+
+    for (i = 0; i < iIovCnt && xResult == MQTTSuccess; i++)
+    {
+        size_t uxLen = (size_t)pxIov[i].len;
+
+        if (uxUsed + uxLen > uxStagingSize)
+        {
+            xResult = prvMqttSendAll(pxMQTTContext, pucStaging, uxUsed);
+            uxUsed = 0;
+        }
+
+        if (xResult != MQTTSuccess)
+        {
+            break;
+        }
+
+        if (uxLen >= uxStagingSize)
+        {
+            xResult = prvMqttSendAll(pxMQTTContext, pxIov[i].base, uxLen);
+        }
+        else
+        {
+            memcpy(pucStaging + uxUsed, pxIov[i].base, uxLen);
+            uxUsed += uxLen;
+        }
+    }
+
+    if (xResult == MQTTSuccess && uxUsed > 0)
+    {
+        xResult = prvMqttSendAll(pxMQTTContext, pucStaging, uxUsed);
+    }
+
+    return xResult;
+}
+
+MQTTStatus_t eMqttPublishQuickConnectv(MQTTContext_t* pxMQTTContext,
+    const char* pcThingName, const json_gen_iov_t* pxIov, int iIovCnt)
 {
     MQTTStatus_t xResult;
     MQTTPublishInfo_t xMQTTPublishInfo = { 0 };
+    size_t uxRemainingLength = 0;
+    size_t uxPacketSize = 0;
+    size_t uxHeaderSize = 0;
+    size_t uxPayloadLength = 0;
+    int i;
+
+    for (i = 0; i < iIovCnt; i++)
+    {
+        uxPayloadLength += (size_t)pxIov[i].len;
+    }
 
     xMQTTPublishInfo.qos = MQTTQoS0;
     xMQTTPublishInfo.retain = false;
     xMQTTPublishInfo.pTopicName = pcThingName;
     xMQTTPublishInfo.topicNameLength = (uint16_t)strlen(pcThingName);
-    xMQTTPublishInfo.pPayload = pcSendBuffer;
-    xMQTTPublishInfo.payloadLength = strlen(pcSendBuffer);
+    xMQTTPublishInfo.payloadLength = uxPayloadLength;
 
-    /* Get a unique packet id. */
-    usPublishPacketIdentifier = MQTT_GetPacketId(pxMQTTContext);
+    /* The PUBLISH header is serialized here instead of by MQTT_Publish(),
+     * which needs the payload in one buffer. QoS 0 has no packet id. */
+    xResult = MQTT_GetPublishPacketSize(&xMQTTPublishInfo, &uxRemainingLength,
+        &uxPacketSize);
 
-    /* Send PUBLISH packet. */
-    xResult = MQTT_Publish(pxMQTTContext, &xMQTTPublishInfo, 
-        usPublishPacketIdentifier);
+    if (xResult == MQTTSuccess)
+    {
+        xResult = MQTT_SerializePublishHeader(&xMQTTPublishInfo, 0,
+            uxRemainingLength, &pxMQTTContext->networkBuffer, &uxHeaderSize);
+    }
+
+    if (xResult == MQTTSuccess)
+    {
+        xResult = prvMqttSendv(pxMQTTContext, uxHeaderSize, pxIov, iIovCnt);
+    }
 
-    if (xResult == MQTTSendFailed)
+    if (xResult != MQTTSuccess)
     {
         ESP_LOGE(TAG, "MQTT publish failed.");
     }
     else
     {
-        ESP_LOGI(TAG, "MQTT publish succeeded.\n Sent: %s", pcSendBuffer);
+        ESP_LOGI(TAG, "MQTT publish succeeded.\n Sent %u bytes in %d segments.",
+            (unsigned)uxPayloadLength, iIovCnt);
     }
 
     return xResult;
@@ -25,6 +25,7 @@
 
 #include "core_mqtt.h"
 #include "esp_tls.h"
+#include "json_generator.h"
 
 struct NetworkContext
 {
@@ -45,7 +46,16 @@ BaseType_t xTlsDisconnect(NetworkContext_t* pxNetworkContext);
 MQTTStatus_t eMqttConnect(MQTTContext_t* pxMQTTContext, 
     const char* pcThingName);
 
-MQTTStatus_t eMqttPublishQuickConnect(MQTTContext_t* pxMQTTContext, 
-    const char* pcThingName, const char* pcSendBuffer);
+/* Publishes a payload given as a list of segments (see
+ * json_gen_str_start_iov()) with QoS 0. Segments are gathered after the
+ * PUBLISH header in the MQTT network buffer, which is sent whenever it fills
+ * up, so a payload smaller than that buffer is still assembled in full there.
+ * Only segments at least as large as the buffer are sent from where they are.
+ *
+ * The packet is sent straight through the transport, bypassing
+ * MQTT_Publish(), so coreMQTT does not update its last sent time and the
+ * keep-alive may send a PINGREQ even while publishes are going out. */
+MQTTStatus_t eMqttPublishQuickConnectv(MQTTContext_t* pxMQTTContext,
+    const char* pcThingName, const json_gen_iov_t* pxIov, int iIovCnt);
 
 #endif /* QUICK_CONNECT_NETWORKING_H */
\ No newline at end of file